@@ -0,0 +1,676 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#define REGS 14
+#define R_MIXER 7
+#define R_SHAPE 13
+#define NOWRITE 0xff
+#define MIXER_IOA_OUT 0x40
+
+#define AY_CLOCK 1573438
+
+/* VBLANK rate is 25.175 MHz / (800 * 525) = 60000 / 1001 Hz */
+#define VBLANK_NUM 60000
+#define VBLANK_DEN 1001
+
+/* VBLANK lasts rows 480-524, 45 * 800 pixel clocks */
+#define VBLANK_PCLK (45UL * 800UL)
+#define PCLK 25175000UL
+
+#define CMD_WAIT 0x40
+#define CMD_END 0x7f
+#define CMD_REF 0x80
+#define WAIT_MAX 62
+#define REF_MAX 128
+#define REF_SIZE 3
+
+/* Z180 T-states of player.asm paths, see comments there */
+#define T_PENDING 48
+#define T_ENTRY 39
+#define T_TOKEN_REF 23
+#define T_TOKEN_WAIT 34
+#define T_TOKEN_FRAME 32
+#define T_REF 93
+#define T_WAIT 43
+#define T_END 26
+#define T_MASK_LO 24
+#define T_MASK_HI 14
+#define T_MASK_EMPTY 8
+#define T_MASK_START 10
+#define T_BIT 11
+#define T_BIT_CLEAR 16
+#define T_BIT_SET 48
+#define T_BIT_LAST 46
+#define T_DONE 53
+#define T_DONE_REF 76
+#define T_DONE_REF_LAST 89
+
+struct frame {
+	uint8_t reg[REGS];
+};
+
+struct cmd {
+	uint8_t data[2 + REGS];
+	uint8_t len;
+	uint8_t literal;
+	uint32_t seg;
+	size_t off;
+};
+
+static const uint8_t regmask[REGS] = {
+	0xff, 0x0f, 0xff, 0x0f, 0xff, 0x0f, 0x1f, 0xff,
+	0x1f, 0x1f, 0x1f, 0xff, 0xff, 0x0f
+};
+
+static struct frame *frames;
+static size_t nframes, cframes;
+
+static struct frame *frame_add(void)
+{
+	if (nframes == cframes) {
+		cframes = cframes ? 2 * cframes : 1024;
+		frames = realloc(frames, cframes * sizeof(*frames));
+		if (frames == NULL) {
+			fprintf(stderr, "Out of memory\n");
+			exit(1);
+		}
+	}
+
+	struct frame *f = &frames[nframes++];
+	memset(f->reg, 0, sizeof(f->reg));
+	f->reg[R_SHAPE] = NOWRITE;
+
+	return f;
+}
+
+static uint8_t *file_read(const char *path, size_t *size)
+{
+	FILE *f = fopen(path, "rb");
+	if (f == NULL) { perror(path); exit(1); }
+
+	fseek(f, 0, SEEK_END);
+	long len = ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	uint8_t *buf = malloc(len ? len : 1);
+	if (buf == NULL || fread(buf, 1, len, f) != (size_t)len) {
+		perror(path);
+		exit(1);
+	}
+	fclose(f);
+
+	*size = len;
+	return buf;
+}
+
+static uint32_t be32(const uint8_t *p)
+{
+	return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | p[2] << 8 | p[3];
+}
+
+static uint16_t be16(const uint8_t *p)
+{
+	return p[0] << 8 | p[1];
+}
+
+static void import_raw(const uint8_t *buf, size_t size)
+{
+	for (size_t i = 0; i + REGS <= size; i += REGS)
+		memcpy(frame_add()->reg, buf + i, REGS);
+}
+
+/* Register writes accumulate until 0xff (next interrupt) or 0xfe n
+ * (n * 4 interrupts) */
+static void import_psg(const uint8_t *buf, size_t size, uint16_t *rate)
+{
+	uint8_t state[REGS] = { 0 }, shape = NOWRITE;
+	int pending = 0;
+
+	/* Version 10+ headers carry the interrupt rate, older ones are 50 Hz */
+	*rate = (size > 5 && buf[4] >= 10 && buf[5] != 0) ? buf[5] : 50;
+
+	for (size_t i = 16; i < size; ) {
+		uint8_t b = buf[i++];
+		size_t cnt = 1;
+
+		if (b == 0xfd)
+			break;
+
+		if (b < 0xfe) {
+			if (i >= size)
+				break;
+			if (b < R_SHAPE)
+				state[b] = buf[i];
+			else if (b == R_SHAPE)
+				shape = buf[i];
+			++i;
+			pending = 1;
+			continue;
+		}
+
+		if (b == 0xfe) {
+			if (i >= size)
+				break;
+			cnt = 4 * buf[i++];
+		}
+
+		while (cnt--) {
+			struct frame *f = frame_add();
+			memcpy(f->reg, state, R_SHAPE);
+			f->reg[R_SHAPE] = shape;
+			shape = NOWRITE;
+		}
+		pending = 0;
+	}
+
+	if (pending) {
+		struct frame *f = frame_add();
+		memcpy(f->reg, state, R_SHAPE);
+		f->reg[R_SHAPE] = shape;
+	}
+}
+
+static uint32_t import_ym(const uint8_t *buf, size_t size, uint16_t *rate)
+{
+	uint32_t clock = 2000000, cnt;
+	size_t pos, nregs = 16;
+	int interleaved = 1;
+
+	if (memcmp(buf, "YM3!", 4) == 0) {
+		*rate = 50;
+		nregs = 14;
+		pos = 4;
+		cnt = (size - 4) / nregs;
+	}
+	else {
+		if (size < 34 || memcmp(buf + 4, "LeOnArD!", 8) != 0) {
+			fprintf(stderr, "Malformed YM header\n");
+			exit(1);
+		}
+
+		cnt = be32(buf + 12);
+		interleaved = be32(buf + 16) & 1;
+		uint16_t drums = be16(buf + 20);
+		clock = be32(buf + 22);
+		*rate = be16(buf + 26);
+		pos = 34 + be16(buf + 32);
+
+		for (uint16_t i = 0; i < drums && pos + 4 <= size; ++i)
+			pos += 4 + be32(buf + pos);
+
+		for (int i = 0; i < 3 && pos < size; ++i)
+			pos += strnlen((const char *)buf + pos, size - pos) + 1;
+	}
+
+	if (pos + (size_t)cnt * nregs > size) {
+		fprintf(stderr, "Truncated YM data\n");
+		exit(1);
+	}
+
+	for (uint32_t i = 0; i < cnt; ++i) {
+		struct frame *f = frame_add();
+		for (size_t r = 0; r < REGS; ++r)
+			f->reg[r] = interleaved ? buf[pos + r * cnt + i] : buf[pos + i * nregs + r];
+	}
+
+	return clock;
+}
+
+static uint32_t rescale(uint32_t period, uint32_t clock, uint32_t max)
+{
+	uint64_t p = (period * (uint64_t)AY_CLOCK + clock / 2) / clock;
+	return (p > max) ? max : p;
+}
+
+static void import(const char *path, uint16_t *rate, int keep)
+{
+	size_t size;
+	uint8_t *buf = file_read(path, &size);
+	uint32_t clock = AY_CLOCK;
+
+	if (size >= 7 && memcmp(buf + 2, "-lh", 3) == 0) {
+		fprintf(stderr, "%s: LHA compressed YM, depack it first\n", path);
+		exit(1);
+	}
+
+	if (size >= 4 && memcmp(buf, "PSG\x1a", 4) == 0)
+		import_psg(buf, size, rate);
+	else if (size >= 4 && (memcmp(buf, "YM3!", 4) == 0 || memcmp(buf, "YM5!", 4) == 0 ||
+				memcmp(buf, "YM6!", 4) == 0))
+		clock = import_ym(buf, size, rate);
+	else if (size >= 4 && buf[0] == 'Y' && buf[1] == 'M' && (buf[3] == '!' || buf[3] == 'b')) {
+		fprintf(stderr, "%s: YM%c%c not supported, only YM3!, YM5! and YM6!\n", path, buf[2], buf[3]);
+		exit(1);
+	}
+	else
+		import_raw(buf, size);
+
+	free(buf);
+
+	/* Port A drives SCRL0-5 and ROMSEL0-1, it has to stay an output */
+	for (size_t i = 0; i < nframes; ++i)
+		frames[i].reg[R_MIXER] |= MIXER_IOA_OUT;
+
+	if (keep || clock == AY_CLOCK)
+		return;
+
+	/* Rescale periods so the tune keeps its pitch on our clock */
+	for (size_t i = 0; i < nframes; ++i) {
+		uint8_t *r = frames[i].reg;
+		for (int ch = 0; ch < 3; ++ch) {
+			uint32_t p = rescale((r[2 * ch + 1] & 0x0f) << 8 | r[2 * ch], clock, 0xfff);
+			r[2 * ch] = p;
+			r[2 * ch + 1] = p >> 8;
+		}
+
+		r[6] = rescale(r[6] & 0x1f, clock, 0x1f);
+
+		uint32_t p = rescale(r[12] << 8 | r[11], clock, 0xffff);
+		r[11] = p;
+		r[12] = p >> 8;
+	}
+}
+
+/* Repeats or drops frames with an error accumulator so a tune made for
+ * another rate keeps its tempo, envelope writes of dropped frames move to
+ * the next frame and repeated frames don't retrigger */
+static void retime(uint16_t rate)
+{
+	struct frame *src = frames;
+	size_t n = nframes, next = 0;
+	uint64_t acc = 0;
+
+	frames = NULL;
+	nframes = cframes = 0;
+
+	for (size_t i = 0; i < n; ) {
+		struct frame *f = frame_add();
+
+		memcpy(f->reg, src[i].reg, R_SHAPE);
+		for (; next <= i; ++next)
+			if (src[next].reg[R_SHAPE] != NOWRITE)
+				f->reg[R_SHAPE] = src[next].reg[R_SHAPE];
+
+		acc += (uint64_t)rate * VBLANK_DEN;
+		i += acc / VBLANK_NUM;
+		acc %= VBLANK_NUM;
+	}
+
+	free(src);
+}
+
+static struct cmd *commands(size_t *count)
+{
+	struct cmd *cmds = calloc(nframes + 1, sizeof(*cmds));
+	uint8_t state[REGS];
+	size_t n = 0;
+	int first = 1;
+
+	if (cmds == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		exit(1);
+	}
+
+	for (size_t i = 0; i < nframes; ++i) {
+		const uint8_t *r = frames[i].reg;
+		uint16_t mask = 0;
+		uint8_t vals[REGS], nvals = 0;
+
+		for (int reg = 0; reg < REGS; ++reg) {
+			if (reg == R_SHAPE && r[reg] == NOWRITE)
+				continue;
+
+			uint8_t v = r[reg] & regmask[reg];
+			if (first || reg == R_SHAPE || v != state[reg]) {
+				mask |= 1 << reg;
+				vals[nvals++] = v;
+				state[reg] = v;
+			}
+		}
+		first = 0;
+
+		if (mask == 0) {
+			if (n > 0 && cmds[n - 1].data[0] >= CMD_WAIT && cmds[n - 1].data[0] < CMD_WAIT + WAIT_MAX) {
+				++cmds[n - 1].data[0];
+			}
+			else {
+				cmds[n].data[0] = CMD_WAIT + 1;
+				cmds[n++].len = 1;
+			}
+			continue;
+		}
+
+		cmds[n].data[0] = mask >> 8;
+		cmds[n].data[1] = mask;
+		memcpy(cmds[n].data + 2, vals, nvals);
+		cmds[n++].len = 2 + nvals;
+	}
+
+	*count = n;
+	return cmds;
+}
+
+static int cmd_eq(const struct cmd *a, const struct cmd *b)
+{
+	return a->len == b->len && memcmp(a->data, b->data, a->len) == 0;
+}
+
+static size_t pack(struct cmd *cmds, size_t n, uint8_t *out, size_t window)
+{
+	size_t pos = 0, refs = 0, lo = 0;
+	uint32_t seg = 0;
+
+	for (size_t i = 0; i < n; ) {
+		size_t best_len = 0, best_j = 0;
+		long best_save = 0;
+
+		/* Literal offsets only grow, so the window start only moves forward */
+		while (lo < i && (!cmds[lo].literal || pos - cmds[lo].off > window))
+			++lo;
+
+		for (size_t j = lo; j < i; ++j) {
+			if (!cmds[j].literal)
+				continue;
+
+			size_t len = 0;
+			long save = -REF_SIZE;
+			while (len < REF_MAX && i + len < n && j + len < i &&
+					cmds[j + len].literal && cmds[j + len].seg == cmds[j].seg &&
+					cmd_eq(&cmds[j + len], &cmds[i + len])) {
+				save += cmds[i + len].len;
+				++len;
+			}
+
+			if (save > best_save) {
+				best_save = save;
+				best_len = len;
+				best_j = j;
+			}
+		}
+
+		if (best_len > 0) {
+			size_t dist = pos - cmds[best_j].off;
+			out[pos++] = CMD_REF | (best_len - 1);
+			out[pos++] = dist;
+			out[pos++] = dist >> 8;
+			i += best_len;
+			++seg;
+			++refs;
+			continue;
+		}
+
+		cmds[i].literal = 1;
+		cmds[i].seg = seg;
+		cmds[i].off = pos;
+		memcpy(out + pos, cmds[i].data, cmds[i].len);
+		pos += cmds[i].len;
+		++i;
+	}
+
+	out[pos++] = CMD_END;
+
+	fprintf(stderr, "%zu commands, %zu back references\n", n, refs);
+
+	return pos;
+}
+
+struct player {
+	const uint8_t *data;
+	size_t pos;
+	size_t ret;
+	int left;
+	int wait;
+	uint8_t reg[REGS];
+};
+
+static long play_mask(struct player *p, uint8_t mask, int reg, uint8_t *shape)
+{
+	long t;
+
+	if (mask == 0)
+		return T_MASK_EMPTY;
+
+	for (t = T_MASK_START; mask != 0; ++reg) {
+		uint8_t bit = mask & 1;
+
+		mask >>= 1;
+		t += T_BIT;
+
+		if (!bit) {
+			t += T_BIT_CLEAR;
+			continue;
+		}
+
+		p->reg[reg] = p->data[p->pos++];
+		if (reg == R_SHAPE)
+			*shape = p->reg[reg];
+		t += mask ? T_BIT_SET : T_BIT_LAST;
+	}
+
+	return t;
+}
+
+/* Decodes one frame following zay_frame in player.asm, returns T-states or
+ * -1 at the end of stream */
+static long play_frame(struct player *p, uint8_t *shape)
+{
+	long t;
+
+	*shape = NOWRITE;
+
+	if (p->wait > 0) {
+		--p->wait;
+		return T_PENDING;
+	}
+
+	t = T_ENTRY;
+
+	while (1) {
+		size_t start = p->pos;
+		uint8_t tok = p->data[p->pos++];
+
+		if (tok & CMD_REF) {
+			p->left = (tok & 0x7f) + 1;
+			p->ret = p->pos + 2;
+			p->pos = start - (p->data[p->pos] | p->data[p->pos + 1] << 8);
+			t += T_TOKEN_REF + T_REF;
+			continue;
+		}
+
+		if (tok & CMD_WAIT) {
+			t += T_TOKEN_WAIT;
+			if (tok == CMD_END)
+				return -1;
+			p->wait = (tok & 0x3f) - 1;
+			t += T_WAIT;
+		}
+		else {
+			uint8_t lo = p->data[p->pos++];
+
+			t += T_TOKEN_FRAME + T_MASK_LO;
+			t += play_mask(p, lo, 0, shape);
+			t += T_MASK_HI;
+			t += play_mask(p, tok, 8, shape);
+		}
+
+		if (p->left == 0)
+			return t + T_DONE;
+
+		if (--p->left != 0)
+			return t + T_DONE_REF;
+
+		p->pos = p->ret;
+		return t + T_DONE_REF_LAST;
+	}
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "Usage: %s [-w window] [-c hz] [-k] [-F hz] [-s csv] input output.zay\n", name);
+	fprintf(stderr, "\tinput is a YM3/YM5/YM6 (depacked), PSG or raw 14-byte frame dump\n");
+	fprintf(stderr, "\t-w\tback reference window in bytes, default 1024, max 65535\n");
+	fprintf(stderr, "\t-c\tCPU clock, default 6144000\n");
+	fprintf(stderr, "\t-k\tkeep periods of tunes made for a different AY clock\n");
+	fprintf(stderr, "\t-F\tframe rate of the input, default from the file, raw dumps 60\n");
+	fprintf(stderr, "\t-s\twrite per-frame decode T-states to csv\n");
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned long window = 1024, cpu = 6144000;
+	const char *csv = NULL;
+	unsigned long force = 0;
+	uint16_t rate = 0;
+	int keep = 0, opt;
+
+	while ((opt = getopt(argc, argv, "w:c:kF:s:")) != -1) {
+		switch (opt) {
+			case 'w':
+				window = strtoul(optarg, NULL, 0);
+				break;
+
+			case 'c':
+				cpu = strtoul(optarg, NULL, 0);
+				break;
+
+			case 'k':
+				keep = 1;
+				break;
+
+			case 'F':
+				force = strtoul(optarg, NULL, 0);
+				if (force == 0 || force > 1000) {
+					usage(argv[0]);
+					return 1;
+				}
+				break;
+
+			case 's':
+				csv = optarg;
+				break;
+
+			default:
+				usage(argv[0]);
+				return 1;
+		}
+	}
+
+	if (argc - optind != 2 || window == 0 || window > 0xffff || cpu == 0) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	import(argv[optind], &rate, keep);
+	if (nframes == 0) {
+		fprintf(stderr, "%s: no frames\n", argv[optind]);
+		return 1;
+	}
+
+	if (force)
+		rate = force;
+
+	/* 60 Hz tunes play 0.1% slow, which is not worth dropping frames */
+	if (rate != 0 && rate != 60) {
+		size_t n = nframes;
+
+		retime(rate);
+		fprintf(stderr, "Retimed %u Hz tune to 59.94 Hz, %zu -> %zu frames\n", rate, n, nframes);
+	}
+
+	size_t ncmds;
+	struct cmd *cmds = commands(&ncmds);
+
+	uint8_t *out = malloc(ncmds * (2 + REGS) + 1);
+	if (out == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+
+	size_t size = pack(cmds, ncmds, out, window);
+
+	FILE *f = fopen(argv[optind + 1], "wb");
+	if (f == NULL) { perror(argv[optind + 1]); return 1; }
+
+	uint8_t hdr[10] = { 'Z', 'A', 'Y', 1 };
+	for (int i = 0; i < 4; ++i)
+		hdr[4 + i] = nframes >> (8 * i);
+	hdr[8] = window;
+	hdr[9] = window >> 8;
+
+	if (fwrite(hdr, sizeof(hdr), 1, f) != 1 || fwrite(out, size, 1, f) != 1 || fclose(f) != 0) {
+		perror(argv[optind + 1]);
+		return 1;
+	}
+
+	FILE *fcsv = NULL;
+	if (csv != NULL) {
+		fcsv = fopen(csv, "w");
+		if (fcsv == NULL) { perror(csv); return 1; }
+		fprintf(fcsv, "frame,tstates\n");
+	}
+
+	/* Decode back to verify and measure */
+	struct player p = { .data = out };
+	unsigned long budget = VBLANK_PCLK * cpu / PCLK;
+	long tmin = -1, tmax = 0;
+	unsigned long long tsum = 0;
+	size_t over = 0, worst = 0;
+
+	for (size_t i = 0; i < nframes; ++i) {
+		uint8_t shape;
+		long t = play_frame(&p, &shape);
+
+		if (t < 0) {
+			fprintf(stderr, "Decode ended early at frame %zu\n", i);
+			return 1;
+		}
+
+		for (int reg = 0; reg < R_SHAPE; ++reg) {
+			if (p.reg[reg] != (frames[i].reg[reg] & regmask[reg])) {
+				fprintf(stderr, "Decode mismatch at frame %zu, R%d\n", i, reg);
+				return 1;
+			}
+		}
+
+		uint8_t expect = frames[i].reg[R_SHAPE];
+		if (expect != NOWRITE)
+			expect &= regmask[R_SHAPE];
+		if (shape != expect) {
+			fprintf(stderr, "Decode mismatch at frame %zu, R13\n", i);
+			return 1;
+		}
+
+		if (fcsv != NULL)
+			fprintf(fcsv, "%zu,%ld\n", i, t);
+
+		if (tmin < 0 || t < tmin)
+			tmin = t;
+		if (t > tmax) {
+			tmax = t;
+			worst = i;
+		}
+		if ((unsigned long)t > budget)
+			++over;
+		tsum += t;
+	}
+
+	if (fcsv != NULL)
+		fclose(fcsv);
+
+	size_t raw = nframes * REGS;
+	printf("frames:  %zu\n", nframes);
+	printf("size:    %zu -> %zu bytes (%.1f%%)\n", raw, size + sizeof(hdr), 100. * (size + sizeof(hdr)) / raw);
+	printf("decode:  min %ld, avg %.1f, max %ld T-states (frame %zu)\n", tmin, (double)tsum / nframes, tmax, worst);
+	printf("budget:  %lu T-states per VBLANK @ %lu Hz, worst frame uses %.1f%%\n", budget, cpu, 100. * tmax / budget);
+	if (over > 0)
+		printf("WARNING: %zu frames exceed the VBLANK budget\n", over);
+
+	free(out);
+	free(cmds);
+	free(frames);
+
+	return 0;
+}
@@ -0,0 +1,147 @@
+; ZAY player, decodes one aypack frame per call.
+; z88dk z80asm syntax. Comments give Z180 T-states without wait states,
+; taken/not taken for conditional jumps. aypack.c sums the same paths.
+;
+; zay_init:  HL = stream, i.e. first byte after the 10-byte header
+; zay_frame: call once per VBLANK, returns with carry set at end of stream
+;            clobbers AF, C, DE, HL
+
+	SECTION code_user
+
+	PUBLIC zay_init
+	PUBLIC zay_frame
+
+; A0 of the AY chip select selects latch address / write data
+	defc AY_ADDR = 0xc0
+	defc AY_DATA = 0xc1
+
+zay_init:
+	ld   (zay_ptr),hl
+	xor  a
+	ld   (zay_wait),a
+	ld   (zay_left),a
+	ret
+
+; Pending no-change frame: 12 + 4 + 6 + 4 + 13 + 9 = 48
+zay_frame:
+	ld   a,(zay_wait)        ; 12
+	or   a                   ; 4
+	jr   z,zay_next          ; 8/6
+	dec  a                   ; 4
+	ld   (zay_wait),a        ; 13
+	ret                      ; 9
+
+; Entry into decoding: 12 + 4 + 8 + 15 = 39
+zay_next:
+	ld   hl,(zay_ptr)        ; 15
+
+; Token dispatch: back reference 6 + 4 + 4 + 9 = 23,
+; wait/end 6 + 4 + 4 + 6 + 6 + 8 = 34, register frame 6 + 4 + 4 + 6 + 6 + 6 = 32
+zay_token:
+	ld   a,(hl)              ; 6
+	inc  hl                  ; 4
+	or   a                   ; 4
+	jp   m,zay_ref           ; 9/6
+	cp   0x40                ; 6
+	jr   nc,zay_cmd_wait     ; 8/6
+
+; Register frame, A = R8-R13 mask, (HL) = R0-R7 mask
+; Head 4 + 6 + 6 + 4 + 4 = 24, then 8 for empty mask or 6 + 4 = 10.
+; Per mask bit up to the highest set one: 4 + 7 = 11, plus
+; clear bit 8 + 8 = 16, set bit 6 + 34 + 8 = 48 or 6 + 34 + 6 = 46 if highest.
+	ld   d,a                 ; 4
+	ld   c,0xff              ; 6
+	ld   a,(hl)              ; 6
+	inc  hl                  ; 4
+	or   a                   ; 4
+	jr   z,zay_hi            ; 8/6
+	ld   e,a                 ; 4
+zay_lo:
+	inc  c                   ; 4
+	srl  e                   ; 7
+	jr   nc,zay_lo_next      ; 8/6
+	ld   a,c                 ; 4
+	out  (AY_ADDR),a         ; 10
+	ld   a,(hl)              ; 6
+	out  (AY_DATA),a         ; 10
+	inc  hl                  ; 4
+zay_lo_next:
+	jr   nz,zay_lo           ; 8/6
+
+; High mask head 6 + 4 + 4 = 14, then 8 for empty mask or 6 + 4 = 10
+zay_hi:
+	ld   c,7                 ; 6
+	ld   a,d                 ; 4
+	or   a                   ; 4
+	jr   z,zay_done          ; 8/6
+	ld   e,a                 ; 4
+zay_hi_bit:
+	inc  c                   ; 4
+	srl  e                   ; 7
+	jr   nc,zay_hi_next      ; 8/6
+	ld   a,c                 ; 4
+	out  (AY_ADDR),a         ; 10
+	ld   a,(hl)              ; 6
+	out  (AY_DATA),a         ; 10
+	inc  hl                  ; 4
+zay_hi_next:
+	jr   nz,zay_hi_bit       ; 8/6
+
+; Command done, HL = next command
+; Outside back reference 12 + 4 + 8 + 16 + 4 + 9 = 53
+; Inside 12 + 4 + 6 + 4 + 13 + 8 + 16 + 4 + 9 = 76
+; Last referenced command 12 + 4 + 6 + 4 + 13 + 6 + 15 + 16 + 4 + 9 = 89
+zay_done:
+	ld   a,(zay_left)        ; 12
+	or   a                   ; 4
+	jr   z,zay_store         ; 8/6
+	dec  a                   ; 4
+	ld   (zay_left),a        ; 13
+	jr   nz,zay_store        ; 8/6
+	ld   hl,(zay_ret)        ; 15
+zay_store:
+	ld   (zay_ptr),hl        ; 16
+	or   a                   ; 4
+	ret                      ; 9
+
+; No change for n frames: 6 + 6 + 6 + 4 + 13 + 8 = 43
+; End of stream: 6 + 8 + 3 + 9 = 26, pointer stays at the end token
+zay_cmd_wait:
+	cp   0x7f                ; 6
+	jr   z,zay_end           ; 8/6
+	and  0x3f                ; 6
+	dec  a                   ; 4
+	ld   (zay_wait),a        ; 13
+	jr   zay_done            ; 8
+zay_end:
+	scf                      ; 3
+	ret                      ; 9
+
+; Back reference, HL = token + 1
+; 6 + 4 + 13 + 6 + 4 + 6 + 4 + 16 + 4 + 4 + 4 + 4 + 10 + 8 = 93
+zay_ref:
+	and  0x7f                ; 6
+	inc  a                   ; 4
+	ld   (zay_left),a        ; 13
+	ld   e,(hl)              ; 6
+	inc  hl                  ; 4
+	ld   d,(hl)              ; 6
+	inc  hl                  ; 4
+	ld   (zay_ret),hl        ; 16
+	dec  hl                  ; 4
+	dec  hl                  ; 4
+	dec  hl                  ; 4
+	or   a                   ; 4
+	sbc  hl,de               ; 10
+	jr   zay_token           ; 8
+
+	SECTION bss_user
+
+zay_ptr:
+	defs 2
+zay_ret:
+	defs 2
+zay_wait:
+	defs 1
+zay_left:
+	defs 1
@@ -0,0 +1,169 @@
+#include <string.h>
+
+#include "ay.h"
+
+/* AY-3-8912 DAC, measured levels scaled so that 3 channels fit in int16 */
+static const int16_t dac[16] = {
+	0, 109, 158, 230, 335, 497, 704, 1173,
+	1383, 2239, 3192, 4072, 5380, 6939, 8799, 10922
+};
+
+static const uint8_t regmask[16] = {
+	0xff, 0x0f, 0xff, 0x0f, 0xff, 0x0f, 0x1f, 0xff,
+	0x1f, 0x1f, 0x1f, 0xff, 0xff, 0x0f, 0xff, 0xff
+};
+
+static void ay_envReset(struct ay *ay)
+{
+	ay->env_cnt = 0;
+	ay->env_vol = 15;
+	ay->env_attack = (ay->reg[AY_REG_ENV_SHAPE] & 0x04) ? 15 : 0;
+	ay->env_holding = 0;
+}
+
+static void ay_envStep(struct ay *ay)
+{
+	uint8_t shape = ay->reg[AY_REG_ENV_SHAPE];
+
+	if (ay->env_vol > 0) {
+		--ay->env_vol;
+		return;
+	}
+
+	if (!(shape & 0x08)) {
+		ay->env_attack = 0;
+		ay->env_holding = 1;
+	}
+	else if (shape & 0x01) {
+		if (shape & 0x02)
+			ay->env_attack ^= 15;
+		ay->env_holding = 1;
+	}
+	else {
+		if (shape & 0x02)
+			ay->env_attack ^= 15;
+		ay->env_vol = 15;
+	}
+}
+
+void ay_reset(struct ay *ay)
+{
+	memset(ay, 0, sizeof(*ay));
+	ay->lfsr = 1;
+	ay_envReset(ay);
+	ay->env_holding = 1;
+	ay->env_vol = 0;
+}
+
+void ay_write(struct ay *ay, uint8_t reg, uint8_t val)
+{
+	reg &= 0x0f;
+	ay->reg[reg] = val & regmask[reg];
+
+	if (reg == AY_REG_ENV_SHAPE)
+		ay_envReset(ay);
+}
+
+uint8_t ay_read(const struct ay *ay, uint8_t reg)
+{
+	return ay->reg[reg & 0x0f];
+}
+
+static uint32_t ay_tonePeriod(const struct ay *ay, int ch)
+{
+	uint32_t period = ay->reg[2 * ch] | (ay->reg[2 * ch + 1] << 8);
+	return period ? period : 1;
+}
+
+static uint32_t ay_noisePeriod(const struct ay *ay)
+{
+	uint32_t period = ay->reg[6];
+	return 2 * (period ? period : 1);
+}
+
+static uint32_t ay_envPeriod(const struct ay *ay)
+{
+	uint32_t period = ay->reg[11] | (ay->reg[12] << 8);
+	return 2 * (period ? period : 1);
+}
+
+static int16_t ay_level(const struct ay *ay)
+{
+	uint8_t mixer = ay->reg[AY_REG_MIXER];
+	uint8_t noise = ay->lfsr & 1;
+	int16_t sum = 0;
+
+	for (int ch = 0; ch < 3; ++ch) {
+		uint8_t tone = ay->tone_out[ch] | ((mixer >> ch) & 1);
+		uint8_t nois = noise | ((mixer >> (ch + 3)) & 1);
+		uint8_t amp = ay->reg[8 + ch];
+		uint8_t vol = (amp & 0x10) ? (ay->env_vol ^ ay->env_attack) : (amp & 0x0f);
+
+		if (tone & nois)
+			sum += dac[vol];
+	}
+
+	return sum;
+}
+
+/* Generator state only changes when a counter expires, so the output is
+ * produced in runs of constant level instead of tick by tick. */
+void ay_render(struct ay *ay, int16_t *out, size_t n)
+{
+	uint32_t tp[3], np, ep;
+
+	for (int ch = 0; ch < 3; ++ch)
+		tp[ch] = ay_tonePeriod(ay, ch);
+	np = ay_noisePeriod(ay);
+	ep = ay_envPeriod(ay);
+
+	while (n > 0) {
+		size_t run = n;
+		uint32_t left;
+
+		for (int ch = 0; ch < 3; ++ch) {
+			left = (ay->tone_cnt[ch] < tp[ch]) ? tp[ch] - ay->tone_cnt[ch] : 1;
+			if (left < run)
+				run = left;
+		}
+
+		left = (ay->noise_cnt < np) ? np - ay->noise_cnt : 1;
+		if (left < run)
+			run = left;
+
+		if (!ay->env_holding) {
+			left = (ay->env_cnt < ep) ? ep - ay->env_cnt : 1;
+			if (left < run)
+				run = left;
+		}
+
+		int16_t level = ay_level(ay);
+		for (size_t i = 0; i < run; ++i)
+			out[i] = level;
+		out += run;
+		n -= run;
+
+		for (int ch = 0; ch < 3; ++ch) {
+			ay->tone_cnt[ch] += run;
+			if (ay->tone_cnt[ch] >= tp[ch]) {
+				ay->tone_cnt[ch] = 0;
+				ay->tone_out[ch] ^= 1;
+			}
+		}
+
+		ay->noise_cnt += run;
+		if (ay->noise_cnt >= np) {
+			uint32_t bit = (ay->lfsr ^ (ay->lfsr >> 3)) & 1;
+			ay->noise_cnt = 0;
+			ay->lfsr = (ay->lfsr >> 1) | (bit << 16);
+		}
+
+		if (!ay->env_holding) {
+			ay->env_cnt += run;
+			if (ay->env_cnt >= ep) {
+				ay->env_cnt = 0;
+				ay_envStep(ay);
+			}
+		}
+	}
+}
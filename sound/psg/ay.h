@@ -0,0 +1,39 @@
+#ifndef AY_H_
+#define AY_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* AY clock is 25.175 MHz / 16, generators tick at clock / 8 */
+#define AY_CLOCK 1573438
+#define AY_RATE  (AY_CLOCK / 8)
+
+#define AY_REG_MIXER 7
+#define AY_REG_ENV_SHAPE 13
+#define AY_REG_PORTA 14
+
+struct ay {
+	uint8_t reg[16];
+
+	uint16_t tone_cnt[3];
+	uint8_t tone_out[3];
+
+	uint16_t noise_cnt;
+	uint32_t lfsr;
+
+	uint32_t env_cnt;
+	uint8_t env_vol;
+	uint8_t env_attack;
+	uint8_t env_holding;
+};
+
+void ay_reset(struct ay *ay);
+
+void ay_write(struct ay *ay, uint8_t reg, uint8_t val);
+
+uint8_t ay_read(const struct ay *ay, uint8_t reg);
+
+/* Renders n samples at AY_RATE, unipolar, full scale 32766 */
+void ay_render(struct ay *ay, int16_t *out, size_t n);
+
+#endif
@@ -0,0 +1,213 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "ay.h"
+#include "wav.h"
+#include "ring.h"
+#include "resample.h"
+#include "filter.h"
+
+/* VBLANK rate: 25.175 MHz / (800 * 525) */
+#define FRAME_NUM 25175000ULL
+#define FRAME_DEN (800ULL * 525ULL)
+
+#define FRAME_REGS 14
+
+#define RING_SIZE (1 << 16)
+
+struct output {
+	struct ring ring;
+	struct wav wav;
+	struct resampler rs;
+	struct filter filter;
+	int native;
+	int err;
+	int errnum;
+};
+
+static void *output_thread(void *arg)
+{
+	struct output *o = arg;
+	static int16_t in[RS_CHUNK], out[RS_CHUNK + 1];
+	static float tmp[RS_CHUNK + 1];
+	size_t n;
+
+	while ((n = ring_read(&o->ring, in, RS_CHUNK)) != 0) {
+		if (o->err)
+			continue;
+
+		if (o->native) {
+			o->err = wav_write(&o->wav, in, n);
+			if (o->err)
+				o->errnum = errno;
+			continue;
+		}
+
+		n = resampler_process(&o->rs, in, n, tmp);
+		filter_process(&o->filter, tmp, n, out);
+		o->err = wav_write(&o->wav, out, n);
+		if (o->err)
+			o->errnum = errno;
+	}
+
+	if (!o->native && !o->err) {
+		n = resampler_flush(&o->rs, tmp);
+		filter_process(&o->filter, tmp, n, out);
+		o->err = wav_write(&o->wav, out, n);
+	}
+
+	if (o->err && !o->errnum)
+		o->errnum = errno;
+
+	return NULL;
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "Usage: %s [-p] [-n] [-f fps] [-r rate] [-H hz] [-L hz] [-g gain] input.psg output.wav\n", name);
+	fprintf(stderr, "\t-p\twrite raw 16-bit PCM instead of WAV\n");
+	fprintf(stderr, "\t-n\twrite unfiltered samples at the AY rate\n");
+	fprintf(stderr, "\t-f\tframe rate, default VBLANK (59.94 Hz)\n");
+	fprintf(stderr, "\t-r\toutput sample rate, default 48000, max %u\n", AY_RATE);
+	fprintf(stderr, "\t-H\thigh-pass corner, default %g Hz, 0 disables\n", FILTER_HP_HZ);
+	fprintf(stderr, "\t-L\tlow-pass corner, default %g Hz, 0 disables\n", FILTER_LP_HZ);
+	fprintf(stderr, "\t-g\toutput gain, default 1.0\n");
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned long long num = FRAME_NUM, den = FRAME_DEN, acc = 0;
+	float hp = FILTER_HP_HZ, lp = FILTER_LP_HZ, gain = 1.f;
+	uint32_t rate = 48000;
+	int raw = 0, native = 0, opt;
+
+	while ((opt = getopt(argc, argv, "pnf:r:H:L:g:")) != -1) {
+		switch (opt) {
+			case 'p':
+				raw = 1;
+				break;
+
+			case 'n':
+				native = 1;
+				break;
+
+			case 'r':
+				rate = strtoul(optarg, NULL, 0);
+				if (rate == 0 || rate > AY_RATE) {
+					usage(argv[0]);
+					return 1;
+				}
+				break;
+
+			case 'H':
+				hp = strtof(optarg, NULL);
+				break;
+
+			case 'L':
+				lp = strtof(optarg, NULL);
+				break;
+
+			case 'g':
+				gain = strtof(optarg, NULL);
+				break;
+
+			case 'f':
+				num = strtoul(optarg, NULL, 0);
+				den = 1;
+				if (num == 0) {
+					usage(argv[0]);
+					return 1;
+				}
+				break;
+
+			default:
+				usage(argv[0]);
+				return 1;
+		}
+	}
+
+	if (argc - optind != 2) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	FILE *in = fopen(argv[optind], "rb");
+	if (in == NULL) { perror(argv[optind]); return 1; }
+
+	static struct output o;
+	if (native)
+		rate = AY_RATE;
+
+	o.native = native;
+	if (ring_init(&o.ring, RING_SIZE) < 0 || (!native && resampler_init(&o.rs, AY_RATE, rate) < 0)) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+	filter_init(&o.filter, rate, hp, lp, gain);
+
+	if (wav_open(&o.wav, argv[optind + 1], rate, raw) < 0) {
+		perror(argv[optind + 1]);
+		return 1;
+	}
+
+	pthread_t tid;
+	if (pthread_create(&tid, NULL, output_thread, &o) != 0) {
+		fprintf(stderr, "Failed to start output thread\n");
+		return 1;
+	}
+
+	struct ay ay;
+	ay_reset(&ay);
+
+	static int16_t buf[AY_RATE];
+	uint8_t frame[FRAME_REGS];
+	size_t frames = 0;
+
+	while (fread(frame, sizeof(frame), 1, in) == 1) {
+		for (uint8_t reg = 0; reg < FRAME_REGS; ++reg) {
+			/* 0xff in the shape register means "not written" */
+			if (reg == AY_REG_ENV_SHAPE && frame[reg] == 0xff)
+				continue;
+			ay_write(&ay, reg, frame[reg]);
+		}
+
+		acc += AY_RATE * den;
+		size_t n = acc / num;
+		acc %= num;
+
+		ay_render(&ay, buf, n);
+		for (size_t i = 0; i < n; )
+			i += ring_write(&o.ring, buf + i, n - i);
+		++frames;
+	}
+
+	fclose(in);
+
+	ring_close(&o.ring);
+	pthread_join(tid, NULL);
+
+	if (o.err < 0) {
+		fprintf(stderr, "%s: %s\n", argv[optind + 1], strerror(o.errnum));
+		wav_close(&o.wav);
+		return 1;
+	}
+
+	if (wav_close(&o.wav) < 0) {
+		perror(argv[optind + 1]);
+		return 1;
+	}
+
+	fprintf(stderr, "%zu frames, %llu samples @ %u Hz\n", frames,
+		(unsigned long long)o.wav.samples, rate);
+
+	ring_free(&o.ring);
+	if (!native)
+		resampler_free(&o.rs);
+
+	return 0;
+}
@@ -0,0 +1,48 @@
+#include <math.h>
+
+#include "filter.h"
+
+void filter_init(struct filter *f, uint32_t rate, float hp_hz, float lp_hz, float gain)
+{
+	float dt = 1.f / rate;
+
+	if (hp_hz > 0.f) {
+		float rc = 1.f / (2.f * (float)M_PI * hp_hz);
+		f->hp_a = rc / (rc + dt);
+	}
+	else {
+		f->hp_a = 1.f;
+	}
+
+	if (lp_hz > 0.f) {
+		float rc = 1.f / (2.f * (float)M_PI * lp_hz);
+		f->lp_a = dt / (rc + dt);
+	}
+	else {
+		f->lp_a = 1.f;
+	}
+
+	f->hp_x = 0.f;
+	f->hp_y = 0.f;
+	f->lp_y = 0.f;
+	f->gain = gain;
+}
+
+void filter_process(struct filter *f, const float *in, size_t n, int16_t *out)
+{
+	for (size_t i = 0; i < n; ++i) {
+		float hp = f->hp_a * (f->hp_y + in[i] - f->hp_x);
+		f->hp_x = in[i];
+		f->hp_y = hp;
+
+		f->lp_y += f->lp_a * (hp - f->lp_y);
+
+		float v = f->lp_y * f->gain;
+		if (v > 32767.f)
+			v = 32767.f;
+		else if (v < -32768.f)
+			v = -32768.f;
+
+		out[i] = lrintf(v);
+	}
+}
@@ -0,0 +1,26 @@
+#ifndef FILTER_H_
+#define FILTER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* LM386 output stage: the 150 uF coupling capacitor into an 8 ohm speaker
+ * forms a ~133 Hz high-pass, the speaker itself rolls off the top end */
+#define FILTER_HP_HZ 133.f
+#define FILTER_LP_HZ 10000.f
+
+struct filter {
+	float hp_a;
+	float hp_x;
+	float hp_y;
+	float lp_a;
+	float lp_y;
+	float gain;
+};
+
+/* Frequency of 0 disables the respective pole */
+void filter_init(struct filter *f, uint32_t rate, float hp_hz, float lp_hz, float gain);
+
+void filter_process(struct filter *f, const float *in, size_t n, int16_t *out);
+
+#endif
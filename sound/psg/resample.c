@@ -0,0 +1,116 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "resample.h"
+
+#define RS_LANES 8
+
+static double sinc(double x)
+{
+	return (x == 0.) ? 1. : sin(M_PI * x) / (M_PI * x);
+}
+
+static double blackman(double x, double len)
+{
+	double t = x / len + 0.5;
+
+	if (t < 0. || t > 1.)
+		return 0.;
+
+	return 0.42 - 0.5 * cos(2. * M_PI * t) + 0.08 * cos(4. * M_PI * t);
+}
+
+int resampler_init(struct resampler *rs, uint32_t in_rate, uint32_t out_rate)
+{
+	if (in_rate == 0 || out_rate == 0)
+		return -1;
+
+	rs->coef = malloc(RS_PHASES * RS_TAPS * sizeof(*rs->coef));
+	if (rs->coef == NULL)
+		return -1;
+
+	/* Cut off a bit below output Nyquist, never above input Nyquist */
+	double fc = 0.45 * ((out_rate < in_rate) ? out_rate : in_rate) / in_rate;
+
+	for (int p = 0; p < RS_PHASES; ++p) {
+		float *h = rs->coef + p * RS_TAPS;
+		double frac = (double)p / RS_PHASES, sum = 0.;
+
+		for (int k = 0; k < RS_TAPS; ++k) {
+			double t = frac + RS_TAPS / 2 - 1 - k;
+			double v = 2. * fc * sinc(2. * fc * t) * blackman(t, RS_TAPS);
+			h[k] = v;
+			sum += v;
+		}
+
+		for (int k = 0; k < RS_TAPS; ++k)
+			h[k] /= sum;
+	}
+
+	/* Half of the filter is primed with silence so output is aligned with
+	 * input, resampler_flush() feeds the other half */
+	memset(rs->hist, 0, sizeof(rs->hist));
+	rs->hlen = RS_TAPS / 2 - 1;
+	rs->pos = 0;
+	rs->step = ((uint64_t)in_rate << 32) / out_rate;
+
+	return 0;
+}
+
+void resampler_free(struct resampler *rs)
+{
+	free(rs->coef);
+	rs->coef = NULL;
+}
+
+/* Independent lane accumulators let the compiler vectorize the sum
+ * without reassociating float math. */
+static float dot(const float *restrict x, const float *restrict h)
+{
+	float acc[RS_LANES] = { 0 };
+
+	for (int i = 0; i < RS_TAPS; i += RS_LANES)
+		for (int j = 0; j < RS_LANES; ++j)
+			acc[j] += x[i + j] * h[i + j];
+
+	float sum = 0.f;
+	for (int j = 0; j < RS_LANES; ++j)
+		sum += acc[j];
+
+	return sum;
+}
+
+size_t resampler_process(struct resampler *rs, const int16_t *in, size_t n, float *out)
+{
+	size_t cnt = 0;
+
+	for (size_t i = 0; i < n; ++i)
+		rs->hist[rs->hlen + i] = in[i];
+	rs->hlen += n;
+
+	while ((rs->pos >> 32) + RS_TAPS <= rs->hlen) {
+		size_t idx = rs->pos >> 32;
+		size_t phase = (uint32_t)rs->pos / ((1ULL << 32) / RS_PHASES);
+
+		out[cnt++] = dot(rs->hist + idx, rs->coef + phase * RS_TAPS);
+		rs->pos += rs->step;
+	}
+
+	size_t drop = rs->pos >> 32;
+	if (drop > rs->hlen)
+		drop = rs->hlen;
+
+	memmove(rs->hist, rs->hist + drop, (rs->hlen - drop) * sizeof(*rs->hist));
+	rs->hlen -= drop;
+	rs->pos -= (uint64_t)drop << 32;
+
+	return cnt;
+}
+
+size_t resampler_flush(struct resampler *rs, float *out)
+{
+	static const int16_t zero[RS_TAPS / 2];
+
+	return resampler_process(rs, zero, RS_TAPS / 2, out);
+}
@@ -0,0 +1,32 @@
+#ifndef RESAMPLE_H_
+#define RESAMPLE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define RS_TAPS 64
+#define RS_PHASES 512
+#define RS_CHUNK 4096
+
+/* Polyphase windowed-sinc FIR resampler */
+struct resampler {
+	float *coef;
+	float hist[RS_TAPS + RS_CHUNK];
+	size_t hlen;
+	uint64_t pos;
+	uint64_t step;
+};
+
+int resampler_init(struct resampler *rs, uint32_t in_rate, uint32_t out_rate);
+
+void resampler_free(struct resampler *rs);
+
+/* Consumes n <= RS_CHUNK samples, out must hold n * out_rate / in_rate + 1
+ * samples, out_rate <= in_rate. Returns number of samples produced. */
+size_t resampler_process(struct resampler *rs, const int16_t *in, size_t n, float *out);
+
+/* Feeds the tail of the filter at the end of stream, out must hold
+ * RS_TAPS / 2 * out_rate / in_rate + 1 samples */
+size_t resampler_flush(struct resampler *rs, float *out);
+
+#endif
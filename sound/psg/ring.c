@@ -0,0 +1,99 @@
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+
+#include "ring.h"
+
+int ring_init(struct ring *ring, size_t size)
+{
+	if (size == 0 || (size & (size - 1)) != 0)
+		return -1;
+
+	ring->buf = malloc(size * sizeof(*ring->buf));
+	if (ring->buf == NULL)
+		return -1;
+
+	ring->mask = size - 1;
+	atomic_init(&ring->head, 0);
+	atomic_init(&ring->tail, 0);
+	atomic_init(&ring->eof, 0);
+
+	return 0;
+}
+
+void ring_free(struct ring *ring)
+{
+	free(ring->buf);
+	ring->buf = NULL;
+}
+
+size_t ring_write(struct ring *ring, const int16_t *buf, size_t n)
+{
+	size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+	size_t tail, space;
+
+	while (1) {
+		tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+		space = ring->mask + 1 - (head - tail);
+		if (space != 0)
+			break;
+		sched_yield();
+	}
+
+	if (n > space)
+		n = space;
+
+	size_t off = head & ring->mask;
+	size_t first = ring->mask + 1 - off;
+	if (first > n)
+		first = n;
+
+	memcpy(ring->buf + off, buf, first * sizeof(*buf));
+	memcpy(ring->buf, buf + first, (n - first) * sizeof(*buf));
+
+	atomic_store_explicit(&ring->head, head + n, memory_order_release);
+
+	return n;
+}
+
+size_t ring_read(struct ring *ring, int16_t *buf, size_t n)
+{
+	size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+	size_t head, avail;
+
+	while (1) {
+		head = atomic_load_explicit(&ring->head, memory_order_acquire);
+		avail = head - tail;
+		if (avail != 0)
+			break;
+		if (atomic_load_explicit(&ring->eof, memory_order_acquire)) {
+			/* Producer might have published data just before eof */
+			head = atomic_load_explicit(&ring->head, memory_order_acquire);
+			avail = head - tail;
+			if (avail == 0)
+				return 0;
+			break;
+		}
+		sched_yield();
+	}
+
+	if (n > avail)
+		n = avail;
+
+	size_t off = tail & ring->mask;
+	size_t first = ring->mask + 1 - off;
+	if (first > n)
+		first = n;
+
+	memcpy(buf, ring->buf + off, first * sizeof(*buf));
+	memcpy(buf + first, ring->buf, (n - first) * sizeof(*buf));
+
+	atomic_store_explicit(&ring->tail, tail + n, memory_order_release);
+
+	return n;
+}
+
+void ring_close(struct ring *ring)
+{
+	atomic_store_explicit(&ring->eof, 1, memory_order_release);
+}
@@ -0,0 +1,29 @@
+#ifndef RING_H_
+#define RING_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+/* Single producer, single consumer sample ring, size must be power of 2 */
+struct ring {
+	int16_t *buf;
+	size_t mask;
+	atomic_size_t head;
+	atomic_size_t tail;
+	atomic_int eof;
+};
+
+int ring_init(struct ring *ring, size_t size);
+
+void ring_free(struct ring *ring);
+
+/* Returns number of samples written, blocks until at least one fits */
+size_t ring_write(struct ring *ring, const int16_t *buf, size_t n);
+
+/* Returns number of samples read, 0 only after ring_close and drain */
+size_t ring_read(struct ring *ring, int16_t *buf, size_t n);
+
+void ring_close(struct ring *ring);
+
+#endif
@@ -0,0 +1,110 @@
+#include <string.h>
+#include <errno.h>
+
+#include "wav.h"
+
+#define WAV_HDR_SIZE 44
+
+/* RIFF size is 36 + data size, both 32-bit */
+#define WAV_MAX_SAMPLES ((UINT32_MAX - 36) / 2)
+
+static void put16(uint8_t *p, uint16_t v)
+{
+	p[0] = v;
+	p[1] = v >> 8;
+}
+
+static void put32(uint8_t *p, uint32_t v)
+{
+	put16(p, v);
+	put16(p + 2, v >> 16);
+}
+
+static int wav_header(struct wav *wav)
+{
+	uint8_t hdr[WAV_HDR_SIZE];
+	uint32_t size = (uint32_t)wav->samples * 2;
+
+	memcpy(hdr, "RIFF", 4);
+	put32(hdr + 4, 36 + size);
+	memcpy(hdr + 8, "WAVEfmt ", 8);
+	put32(hdr + 16, 16);
+	put16(hdr + 20, 1);
+	put16(hdr + 22, 1);
+	put32(hdr + 24, wav->rate);
+	put32(hdr + 28, wav->rate * 2);
+	put16(hdr + 32, 2);
+	put16(hdr + 34, 16);
+	memcpy(hdr + 36, "data", 4);
+	put32(hdr + 40, size);
+
+	if (fseek(wav->f, 0, SEEK_SET) < 0)
+		return -1;
+
+	return (fwrite(hdr, sizeof(hdr), 1, wav->f) == 1) ? 0 : -1;
+}
+
+int wav_open(struct wav *wav, const char *path, uint32_t rate, int raw)
+{
+	wav->f = fopen(path, "wb");
+	if (wav->f == NULL)
+		return -1;
+
+	setvbuf(wav->f, NULL, _IOFBF, 1 << 16);
+
+	wav->raw = raw;
+	wav->rate = rate;
+	wav->samples = 0;
+
+	if (!raw && wav_header(wav) < 0) {
+		fclose(wav->f);
+		return -1;
+	}
+
+	return 0;
+}
+
+int wav_write(struct wav *wav, const int16_t *buf, size_t n)
+{
+	uint8_t chunk[4096];
+	int full = 0;
+
+	if (!wav->raw && n > WAV_MAX_SAMPLES - wav->samples) {
+		n = WAV_MAX_SAMPLES - wav->samples;
+		full = 1;
+	}
+
+	while (n > 0) {
+		size_t len = (n < sizeof(chunk) / 2) ? n : sizeof(chunk) / 2;
+
+		for (size_t i = 0; i < len; ++i)
+			put16(chunk + 2 * i, buf[i]);
+
+		if (fwrite(chunk, 2, len, wav->f) != len)
+			return -1;
+
+		wav->samples += len;
+		buf += len;
+		n -= len;
+	}
+
+	if (full) {
+		errno = EFBIG;
+		return -1;
+	}
+
+	return 0;
+}
+
+int wav_close(struct wav *wav)
+{
+	int err = 0;
+
+	if (!wav->raw)
+		err = wav_header(wav);
+
+	if (fclose(wav->f) != 0)
+		err = -1;
+
+	return err;
+}
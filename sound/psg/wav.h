@@ -0,0 +1,24 @@
+#ifndef WAV_H_
+#define WAV_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+struct wav {
+	FILE *f;
+	int raw;
+	uint32_t rate;
+	uint64_t samples;
+};
+
+/* Mono 16-bit PCM sink, raw != 0 skips the RIFF header */
+int wav_open(struct wav *wav, const char *path, uint32_t rate, int raw);
+
+/* Fails with EFBIG once the data chunk would overflow the 32-bit RIFF sizes,
+ * the samples that fit are written and the header stays valid */
+int wav_write(struct wav *wav, const int16_t *buf, size_t n);
+
+int wav_close(struct wav *wav);
+
+#endif
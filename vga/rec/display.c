@@ -0,0 +1,107 @@
+#include <string.h>
+
+#include "display.h"
+
+static void mark_all(struct display *d)
+{
+	memset(d->dirty, 1, sizeof(d->dirty));
+	memset(d->row_dirty, 1, sizeof(d->row_dirty));
+}
+
+static void mark(struct display *d, uint16_t addr)
+{
+	unsigned col = addr % ZTX_STRIDE;
+	unsigned row = (addr / ZTX_STRIDE - d->scroll) & 63;
+
+	if (col < ZTX_COLS && row < ZTX_ROWS) {
+		d->dirty[row][col] = 1;
+		d->row_dirty[row] = 1;
+	}
+}
+
+void display_init(struct display *d, const uint8_t *rom, int fonts)
+{
+	d->rom = rom;
+	d->fonts = fonts;
+	d->scroll = 0;
+	d->font = 0;
+	memset(d->vram, 0, sizeof(d->vram));
+	memset(d->row_changed, 0, sizeof(d->row_changed));
+	mark_all(d);
+}
+
+void display_write(struct display *d, uint16_t addr, uint8_t v)
+{
+	addr %= ZTX_VRAM;
+	if (d->vram[addr] == v)
+		return;
+
+	d->vram[addr] = v;
+	mark(d, addr);
+}
+
+void display_scroll(struct display *d, uint8_t scroll)
+{
+	scroll &= 0x3f;
+	if (d->scroll == scroll)
+		return;
+
+	d->scroll = scroll;
+	mark_all(d);
+}
+
+void display_font(struct display *d, uint8_t font)
+{
+	/* Smaller ROMs leave the upper ROMSEL lines unconnected */
+	font = (font & (ZTX_FONTS - 1)) % d->fonts;
+	if (d->font == font)
+		return;
+
+	d->font = font;
+	mark_all(d);
+}
+
+void display_frame(struct display *d, const uint8_t *dump)
+{
+	display_scroll(d, dump[ZTX_VRAM]);
+	display_font(d, dump[ZTX_VRAM + 1]);
+
+	if (memcmp(d->vram, dump, ZTX_VRAM) == 0)
+		return;
+
+	for (uint16_t i = 0; i < ZTX_VRAM; ++i)
+		display_write(d, i, dump[i]);
+}
+
+/* ROM bit 0 is a lit pixel, font 0 of font_rom.bin is white on black */
+int display_render(struct display *d)
+{
+	const uint8_t *glyphs = d->rom + d->font * ZTX_FONT_SIZE;
+	int cnt = 0;
+
+	for (int row = 0; row < ZTX_ROWS; ++row) {
+		if (!d->row_dirty[row])
+			continue;
+		d->row_dirty[row] = 0;
+		d->row_changed[row] = 1;
+
+		const uint8_t *line = d->vram + ((row + d->scroll) & 63) * ZTX_STRIDE;
+
+		for (int col = 0; col < ZTX_COLS; ++col) {
+			if (!d->dirty[row][col])
+				continue;
+			d->dirty[row][col] = 0;
+			++cnt;
+
+			const uint8_t *g = glyphs + line[col] * 8;
+			for (int y = 0; y < 8; ++y) {
+				uint8_t *p = &d->fb[row * 8 + y][col * 8];
+
+				for (int x = 0; x < 8; ++x)
+					p[x] = (g[y] & (0x80 >> x)) ? 0 : 255;
+			}
+		}
+	}
+
+	return cnt;
+}
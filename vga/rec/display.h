@@ -0,0 +1,40 @@
+#ifndef DISPLAY_H_
+#define DISPLAY_H_
+
+#include <stdint.h>
+
+#include "ztx.h"
+
+/* Text mode display model. Keeps a 640x480 framebuffer and re-rasterizes
+ * only cells written since the last render, scroll and font bank changes
+ * redraw everything. */
+struct display {
+	const uint8_t *rom;
+	int fonts;
+	uint8_t vram[ZTX_VRAM];
+	uint8_t scroll;
+	uint8_t font;
+	uint8_t dirty[ZTX_ROWS][ZTX_COLS];
+	uint8_t row_dirty[ZTX_ROWS];
+	/* Text rows redrawn by display_render(), cleared by the user */
+	uint8_t row_changed[ZTX_ROWS];
+	uint8_t fb[ZTX_HEIGHT][ZTX_WIDTH];
+};
+
+/* rom holds fonts * ZTX_FONT_SIZE bytes, fonts 1-4 */
+void display_init(struct display *d, const uint8_t *rom, int fonts);
+
+/* addr is the VRAM offset from 0xFE000 */
+void display_write(struct display *d, uint16_t addr, uint8_t v);
+
+void display_scroll(struct display *d, uint8_t scroll);
+
+void display_font(struct display *d, uint8_t font);
+
+/* Applies a ZTX_DUMP byte frame dump */
+void display_frame(struct display *d, const uint8_t *dump);
+
+/* Returns the number of cells redrawn */
+int display_render(struct display *d);
+
+#endif
@@ -0,0 +1,29 @@
+#include "ztx.h"
+
+int ztx_put(FILE *f, uint32_t v)
+{
+	while (v >= 0x80) {
+		if (putc((v & 0x7f) | 0x80, f) == EOF)
+			return -1;
+		v >>= 7;
+	}
+
+	return (putc(v, f) == EOF) ? -1 : 0;
+}
+
+int ztx_get(FILE *f, uint32_t *v)
+{
+	*v = 0;
+
+	for (int shift = 0; shift < 35; shift += 7) {
+		int c = getc(f);
+
+		if (c == EOF)
+			return -1;
+		*v |= (uint32_t)(c & 0x7f) << shift;
+		if (!(c & 0x80))
+			return 0;
+	}
+
+	return -1;
+}
@@ -0,0 +1,37 @@
+#ifndef ZTX_H_
+#define ZTX_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define ZTX_COLS 80
+#define ZTX_ROWS 60
+#define ZTX_WIDTH (ZTX_COLS * 8)
+#define ZTX_HEIGHT (ZTX_ROWS * 8)
+
+/* VRAM at 0xFE000, address is {row[8:3] + scroll, col[9:3]} */
+#define ZTX_STRIDE 128
+#define ZTX_VRAM (64 * ZTX_STRIDE)
+
+/* Frame dump: VRAM, scroll (SCRL[5:0]) and font bank (ROMSEL[1:0]) */
+#define ZTX_DUMP (ZTX_VRAM + 2)
+
+#define ZTX_MAGIC "ZTX\x01"
+#define ZTX_HEADER 8
+#define ZTX_FONT_SIZE 2048
+#define ZTX_FONTS 4
+
+/* VBLANK rate, 25.175 MHz / (800 * 525) */
+#define ZTX_RATE (25175000. / (800. * 525.))
+
+/* Event flags */
+#define ZTX_SCROLL 0x01
+#define ZTX_FONT 0x02
+#define ZTX_CELLS 0x04
+
+/* LEB128 varints, return -1 on I/O error or malformed value */
+int ztx_put(FILE *f, uint32_t v);
+
+int ztx_get(FILE *f, uint32_t *v);
+
+#endif
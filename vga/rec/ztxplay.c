@@ -0,0 +1,375 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "ztx.h"
+#include "display.h"
+
+struct video {
+	int width;
+	int height;
+	int *xmap;
+	int *ymap;
+	uint8_t *pix;
+};
+
+/* Either a ZTX recording or a stream of frame dumps */
+struct input {
+	FILE *f;
+	int dump;
+	uint32_t frames;
+	uint32_t cur;
+	uint32_t next;
+	uint8_t buf[ZTX_DUMP];
+};
+
+static uint8_t font[ZTX_FONTS * ZTX_FONT_SIZE];
+static int fonts;
+
+static int load_font(const char *path)
+{
+	FILE *f = fopen(path, "rb");
+	if (f == NULL) {
+		perror(path);
+		return -1;
+	}
+
+	size_t len = fread(font, 1, sizeof(font), f);
+	fclose(f);
+
+	if (len == 0 || len % ZTX_FONT_SIZE) {
+		fprintf(stderr, "%s: size is not a multiple of %d bytes\n", path, ZTX_FONT_SIZE);
+		return -1;
+	}
+	fonts = len / ZTX_FONT_SIZE;
+
+	return 0;
+}
+
+static int apply(FILE *f, struct display *d)
+{
+	int flags = getc(f);
+	int c;
+
+	if (flags == EOF)
+		return -1;
+
+	if (flags & ZTX_SCROLL) {
+		if ((c = getc(f)) == EOF)
+			return -1;
+		display_scroll(d, c);
+	}
+	if (flags & ZTX_FONT) {
+		if ((c = getc(f)) == EOF)
+			return -1;
+		display_font(d, c);
+	}
+
+	if (flags & ZTX_CELLS) {
+		uint8_t buf[ZTX_VRAM];
+		uint32_t n, skip, len;
+		size_t off = 0;
+
+		if (ztx_get(f, &n))
+			return -1;
+
+		while (n--) {
+			if (ztx_get(f, &skip) || ztx_get(f, &len))
+				return -1;
+			if (len == 0 || skip > ZTX_VRAM - off || len > ZTX_VRAM - off - skip)
+				return -1;
+
+			off += skip;
+			if (fread(buf, 1, len, f) != len)
+				return -1;
+			for (size_t i = 0; i < len; ++i)
+				display_write(d, off + i, buf[i]);
+			off += len;
+		}
+	}
+
+	return 0;
+}
+
+static int input_open(struct input *in, const char *path, struct display *d)
+{
+	uint8_t hdr[ZTX_HEADER + 2];
+
+	in->f = fopen(path, "rb");
+	if (in->f == NULL) {
+		perror(path);
+		return -1;
+	}
+	in->cur = 0;
+
+	if (in->dump) {
+		if (fread(in->buf, 1, ZTX_DUMP, in->f) != ZTX_DUMP) {
+			fprintf(stderr, "%s: no frames\n", path);
+			return -1;
+		}
+		display_frame(d, in->buf);
+		return 0;
+	}
+
+	if (fread(hdr, 1, sizeof(hdr), in->f) != sizeof(hdr) || memcmp(hdr, ZTX_MAGIC, 4) ||
+	    fread(in->buf, 1, ZTX_VRAM, in->f) != ZTX_VRAM) {
+		fprintf(stderr, "%s: not a ZTX recording\n", path);
+		return -1;
+	}
+
+	in->frames = hdr[4] | hdr[5] << 8 | hdr[6] << 16 | (uint32_t)hdr[7] << 24;
+	display_scroll(d, hdr[8]);
+	display_font(d, hdr[9]);
+	for (uint16_t i = 0; i < ZTX_VRAM; ++i)
+		display_write(d, i, in->buf[i]);
+
+	/* next is the frame of the next event, frames once the stream ended */
+	uint32_t delta;
+	if (ztx_get(in->f, &delta) || delta > in->frames) {
+		fprintf(stderr, "%s: corrupt stream\n", path);
+		return -1;
+	}
+	in->next = delta ? delta : in->frames;
+
+	return 0;
+}
+
+/* Frame after cur at which the display may change */
+static uint32_t input_next(struct input *in)
+{
+	return in->dump ? in->cur + 1 : in->next;
+}
+
+/* Brings the display to frame target >= cur, returns 1 past the end of the
+ * input and -1 on a corrupt or unreadable stream */
+static int input_seek(struct input *in, struct display *d, uint32_t target)
+{
+	if (in->dump) {
+		int got = 0;
+
+		while (in->cur < target) {
+			if (fread(in->buf, 1, ZTX_DUMP, in->f) != ZTX_DUMP)
+				return ferror(in->f) ? -1 : 1;
+			++in->cur;
+			got = 1;
+		}
+
+		/* Only the last frame matters, the display diffs it */
+		if (got)
+			display_frame(d, in->buf);
+		return 0;
+	}
+
+	if (target >= in->frames)
+		return 1;
+
+	while (in->next <= target) {
+		uint32_t delta;
+
+		if (apply(in->f, d) || ztx_get(in->f, &delta) || delta > in->frames - in->next)
+			return -1;
+		in->cur = in->next;
+		in->next = delta ? in->next + delta : in->frames;
+	}
+	in->cur = target;
+
+	return 0;
+}
+
+static int video_init(struct video *v, int width, int height)
+{
+	v->width = width;
+	v->height = height;
+	v->xmap = malloc(width * sizeof(*v->xmap));
+	v->ymap = malloc(height * sizeof(*v->ymap));
+	v->pix = malloc((size_t)width * height);
+
+	if (v->xmap == NULL || v->ymap == NULL || v->pix == NULL)
+		return -1;
+
+	for (int x = 0; x < width; ++x)
+		v->xmap[x] = (long)x * ZTX_WIDTH / width;
+	for (int y = 0; y < height; ++y)
+		v->ymap[y] = (long)y * ZTX_HEIGHT / height;
+
+	return 0;
+}
+
+static void video_free(struct video *v)
+{
+	free(v->xmap);
+	free(v->ymap);
+	free(v->pix);
+}
+
+/* Nearest neighbour scaling of text rows redrawn since the last call */
+static void scale(struct video *v, struct display *d)
+{
+	for (int y = 0; y < v->height; ++y) {
+		int sy = v->ymap[y];
+
+		if (!d->row_changed[sy / 8])
+			continue;
+
+		uint8_t *dst = v->pix + (size_t)y * v->width;
+		for (int x = 0; x < v->width; ++x)
+			dst[x] = d->fb[sy][v->xmap[x]];
+	}
+
+	memset(d->row_changed, 0, sizeof(d->row_changed));
+}
+
+static int write_pgm(FILE *f, struct video *v)
+{
+	fprintf(f, "P5\n%d %d\n255\n", v->width, v->height);
+	fwrite(v->pix, 1, (size_t)v->width * v->height, f);
+
+	return (fflush(f) != 0 || ferror(f)) ? -1 : 0;
+}
+
+static int save_pgm(const char *prefix, uint32_t frame, struct video *v)
+{
+	char path[4096];
+
+	snprintf(path, sizeof(path), "%s%08u.pgm", prefix, frame);
+
+	FILE *f = fopen(path, "wb");
+	if (f == NULL || write_pgm(f, v) || fclose(f) != 0) {
+		perror(path);
+		return -1;
+	}
+
+	return 0;
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "Usage: %s -f font.bin [-d] [-W width] [-H height] [-r fps | -n frame | -o prefix] input\n", name);
+	fprintf(stderr, "\twrites raw 8-bit gray frames to stdout unless -n or -o is given\n");
+	fprintf(stderr, "\t-f\tfont ROM image, e.g. vga/font/font_rom.bin\n");
+	fprintf(stderr, "\t-d\tinput is a stream of %d-byte frame dumps instead of ZTX\n", ZTX_DUMP);
+	fprintf(stderr, "\t-W\toutput width, default %d\n", ZTX_WIDTH);
+	fprintf(stderr, "\t-H\toutput height, default %d\n", ZTX_HEIGHT);
+	fprintf(stderr, "\t-r\traw video frame rate, default VBLANK rate %.2f\n", ZTX_RATE);
+	fprintf(stderr, "\t-n\twrite a single frame as PGM to stdout\n");
+	fprintf(stderr, "\t-o\twrite a PGM file prefixNNNNNNNN.pgm for every change\n");
+}
+
+int main(int argc, char *argv[])
+{
+	static struct display d;
+	static struct input in;
+	struct video v = { 0 };
+	const char *font_path = NULL, *prefix = NULL;
+	int width = ZTX_WIDTH, height = ZTX_HEIGHT, opt, ret = 1, r;
+	long single = -1;
+	double fps = ZTX_RATE;
+
+	while ((opt = getopt(argc, argv, "f:dW:H:r:n:o:")) != -1) {
+		switch (opt) {
+			case 'f':
+				font_path = optarg;
+				break;
+			case 'd':
+				in.dump = 1;
+				break;
+			case 'W':
+				width = atoi(optarg);
+				break;
+			case 'H':
+				height = atoi(optarg);
+				break;
+			case 'r':
+				fps = atof(optarg);
+				break;
+			case 'n':
+				single = atol(optarg);
+				break;
+			case 'o':
+				prefix = optarg;
+				break;
+			default:
+				usage(argv[0]);
+				return 1;
+		}
+	}
+
+	if (optind + 1 != argc || font_path == NULL || width < 1 || width > 8192 ||
+	    height < 1 || height > 8192 || !(fps > 0.) || single > (long)UINT32_MAX ||
+	    (single >= 0 && prefix != NULL)) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	if (load_font(font_path))
+		return 1;
+
+	display_init(&d, font, fonts);
+	if (input_open(&in, argv[optind], &d))
+		goto out;
+
+	if (video_init(&v, width, height)) {
+		fprintf(stderr, "Out of memory\n");
+		goto out;
+	}
+
+	if (prefix != NULL) {
+		for (;;) {
+			if (display_render(&d)) {
+				scale(&v, &d);
+				if (save_pgm(prefix, in.cur, &v))
+					goto out;
+			}
+
+			if ((r = input_seek(&in, &d, input_next(&in))) < 0)
+				goto corrupt;
+			if (r > 0)
+				break;
+		}
+		ret = 0;
+		goto out;
+	}
+
+	for (uint64_t k = 0; ; ++k) {
+		uint64_t target = single >= 0 ? (uint64_t)single : (uint64_t)(k * ZTX_RATE / fps);
+
+		if (target > UINT32_MAX || (r = input_seek(&in, &d, target)) > 0) {
+			if (single >= 0)
+				fprintf(stderr, "%s: no frame %ld\n", argv[optind], single);
+			break;
+		}
+		if (r < 0)
+			goto corrupt;
+
+		display_render(&d);
+		scale(&v, &d);
+
+		if (single >= 0) {
+			if (write_pgm(stdout, &v) == 0)
+				ret = 0;
+			goto out;
+		}
+
+		if (fwrite(v.pix, 1, (size_t)width * height, stdout) != (size_t)width * height)
+			break;
+	}
+
+	if (single >= 0)
+		goto out;
+	if (fflush(stdout) != 0 || ferror(stdout))
+		perror("stdout");
+	else
+		ret = 0;
+	goto out;
+
+corrupt:
+	fprintf(stderr, "%s: corrupt or unreadable stream after frame %u\n", argv[optind], in.cur);
+out:
+	video_free(&v);
+	if (in.f != NULL)
+		fclose(in.f);
+
+	return ret;
+}
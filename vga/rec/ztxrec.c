@@ -0,0 +1,159 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "ztx.h"
+
+/* A new run costs at least two bytes, shorter gaps are stored as data */
+#define MERGE_GAP 2
+
+struct run {
+	uint16_t off;
+	uint16_t len;
+};
+
+static size_t diff(const uint8_t *prev, const uint8_t *cur, struct run *run)
+{
+	size_t n = 0;
+
+	for (size_t i = 0; i < ZTX_VRAM; ) {
+		if (prev[i] == cur[i]) {
+			++i;
+			continue;
+		}
+
+		size_t end = i + 1;
+		for (size_t j = end; j < ZTX_VRAM && j - end <= MERGE_GAP; ++j)
+			if (prev[j] != cur[j])
+				end = j + 1;
+
+		run[n].off = i;
+		run[n].len = end - i;
+		++n;
+		i = end;
+	}
+
+	return n;
+}
+
+static void put32(uint8_t *p, uint32_t v)
+{
+	p[0] = v;
+	p[1] = v >> 8;
+	p[2] = v >> 16;
+	p[3] = v >> 24;
+}
+
+int main(int argc, char *argv[])
+{
+	static uint8_t prev[ZTX_DUMP], cur[ZTX_DUMP];
+	static struct run run[ZTX_VRAM];
+	uint8_t hdr[ZTX_HEADER];
+	uint32_t frames = 1, delta = 0;
+	size_t events = 0;
+
+	if (argc != 3) {
+		fprintf(stderr, "Usage: %s dump output.ztx\n", argv[0]);
+		fprintf(stderr, "\tdump is a stream of %d-byte frames, one per VBLANK, - for stdin\n", ZTX_DUMP);
+		return 1;
+	}
+
+	FILE *in = strcmp(argv[1], "-") ? fopen(argv[1], "rb") : stdin;
+	if (in == NULL) {
+		perror(argv[1]);
+		return 1;
+	}
+
+	if (fread(prev, 1, ZTX_DUMP, in) != ZTX_DUMP) {
+		fprintf(stderr, "%s: no frames\n", argv[1]);
+		return 1;
+	}
+	prev[ZTX_VRAM] &= 0x3f;
+	prev[ZTX_VRAM + 1] &= ZTX_FONTS - 1;
+
+	FILE *out = fopen(argv[2], "wb");
+	if (out == NULL) {
+		perror(argv[2]);
+		return 1;
+	}
+
+	/* Frame count is patched in at the end */
+	memcpy(hdr, ZTX_MAGIC, 4);
+	put32(hdr + 4, 0);
+	fwrite(hdr, 1, ZTX_HEADER, out);
+	fwrite(prev + ZTX_VRAM, 1, 2, out);
+	fwrite(prev, 1, ZTX_VRAM, out);
+
+	size_t len;
+	while ((len = fread(cur, 1, ZTX_DUMP, in)) == ZTX_DUMP) {
+		if (frames == UINT32_MAX) {
+			fprintf(stderr, "Too many frames, rest ignored\n");
+			break;
+		}
+		++frames;
+		++delta;
+
+		cur[ZTX_VRAM] &= 0x3f;
+		cur[ZTX_VRAM + 1] &= ZTX_FONTS - 1;
+
+		if (memcmp(prev, cur, ZTX_DUMP) == 0)
+			continue;
+
+		uint8_t flags = 0;
+		size_t n = 0;
+
+		if (cur[ZTX_VRAM] != prev[ZTX_VRAM])
+			flags |= ZTX_SCROLL;
+		if (cur[ZTX_VRAM + 1] != prev[ZTX_VRAM + 1])
+			flags |= ZTX_FONT;
+		if (memcmp(prev, cur, ZTX_VRAM) != 0) {
+			flags |= ZTX_CELLS;
+			n = diff(prev, cur, run);
+		}
+
+		ztx_put(out, delta);
+		putc(flags, out);
+		if (flags & ZTX_SCROLL)
+			putc(cur[ZTX_VRAM], out);
+		if (flags & ZTX_FONT)
+			putc(cur[ZTX_VRAM + 1], out);
+		if (flags & ZTX_CELLS) {
+			size_t pos = 0;
+
+			ztx_put(out, n);
+			for (size_t i = 0; i < n; ++i) {
+				ztx_put(out, run[i].off - pos);
+				ztx_put(out, run[i].len);
+				fwrite(cur + run[i].off, 1, run[i].len, out);
+				pos = run[i].off + run[i].len;
+			}
+		}
+
+		memcpy(prev, cur, ZTX_DUMP);
+		delta = 0;
+		++events;
+	}
+
+	if (ferror(in)) {
+		perror(argv[1]);
+		return 1;
+	}
+	if (len != 0 && len != ZTX_DUMP)
+		fprintf(stderr, "Warning: truncated last frame ignored\n");
+
+	/* Zero delta ends the stream, frames after the last event repeat it */
+	ztx_put(out, 0);
+
+	long size = ftell(out);
+	put32(hdr + 4, frames);
+	if (ferror(out) || fseek(out, 4, SEEK_SET) != 0 || fwrite(hdr + 4, 1, 4, out) != 4 || fclose(out) != 0) {
+		perror(argv[2]);
+		return 1;
+	}
+
+	fprintf(stderr, "%u frames (%.1f s), %zu events, %ld bytes\n",
+		frames, frames / ZTX_RATE, events, size);
+
+	return 0;
+}
@@ -0,0 +1,953 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+
+#include "z180.h"
+
+/* VBLANK lasts rows 480-524, 45 * 800 pixel clocks */
+#define VBLANK_PCLK (45UL * 800UL)
+#define PCLK 25175000UL
+
+#define EXIT_NODE -1
+
+enum { ANNOT_LOOP, ANNOT_REPEAT, ANNOT_JUMP, ANNOT_EXTERN };
+
+struct annot {
+	int kind;
+	uint16_t addr;
+	long long val;
+};
+
+struct sym {
+	char name[64];
+	uint16_t addr;
+};
+
+struct edge {
+	int from;
+	int to;
+	long long cost;
+};
+
+struct loop {
+	int header;
+	int parent;
+	size_t size;
+	uint8_t *body;
+	int *exits;
+	size_t nexits;
+	long long cost;
+};
+
+struct graph {
+	int *map;
+	uint16_t *addr;
+	size_t nnodes, cnodes;
+	struct edge *edges;
+	size_t nedges, cedges;
+	int *out_start, *out_idx;
+	int *in_start, *in_idx;
+	struct loop *loops;
+	size_t nloops;
+	int *inner;
+};
+
+struct report {
+	uint16_t addr;
+	uint16_t func;
+	long long val;
+	long long iter;
+};
+
+static uint8_t image[0x10000 + 4];
+static uint8_t loaded[0x10000];
+
+static struct annot *annots;
+static size_t nannots;
+
+static struct sym *syms;
+static size_t nsyms;
+
+static uint8_t fstate[0x10000];
+static long long fwcet[0x10000];
+
+static struct report *funcs, *loops;
+static size_t nfuncs, nloops;
+
+static unsigned mwait, iwait;
+
+static void *xrealloc(void *ptr, size_t size)
+{
+	ptr = realloc(ptr, size);
+	if (ptr == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		exit(1);
+	}
+	return ptr;
+}
+
+static const char *sym_name(uint16_t addr)
+{
+	static char buf[96];
+	const struct sym *best = NULL;
+
+	for (size_t i = 0; i < nsyms; ++i) {
+		if (syms[i].addr <= addr && (best == NULL || syms[i].addr > best->addr))
+			best = &syms[i];
+	}
+
+	if (best == NULL)
+		return "";
+	if (best->addr == addr)
+		return best->name;
+
+	snprintf(buf, sizeof(buf), "%s+0x%x", best->name, addr - best->addr);
+	return buf;
+}
+
+static int is_ident(const char *s)
+{
+	if (!isalpha((unsigned char)*s) && *s != '_' && *s != '.')
+		return 0;
+	for (; *s; ++s) {
+		if (!isalnum((unsigned char)*s) && *s != '_' && *s != '.' && *s != '$')
+			return 0;
+	}
+	return 1;
+}
+
+static void sym_add(const char *name, unsigned long addr)
+{
+	if (!is_ident(name) || addr > 0xffff)
+		return;
+
+	syms = xrealloc(syms, (nsyms + 1) * sizeof(*syms));
+	snprintf(syms[nsyms].name, sizeof(syms[nsyms].name), "%s", name);
+	syms[nsyms++].addr = addr;
+}
+
+/* Accepts z88dk "name = $addr", SDCC noi "DEF name 0xaddr" and SDCC map
+ * "addr name" lines */
+static void map_load(const char *path)
+{
+	FILE *f = fopen(path, "r");
+	char line[512], a[128], b[128];
+	unsigned long addr;
+
+	if (f == NULL) { perror(path); exit(1); }
+
+	while (fgets(line, sizeof(line), f) != NULL) {
+		if (sscanf(line, "%127s = $%lx", a, &addr) == 2 ||
+				sscanf(line, "%127s = 0x%lx", a, &addr) == 2 ||
+				sscanf(line, "DEF %127s 0x%lx", a, &addr) == 2) {
+			sym_add(a, addr);
+			continue;
+		}
+
+		char *p = line;
+		while (isspace((unsigned char)*p))
+			++p;
+		if (p[0] == 'C' && p[1] == ':')
+			p += 2;
+
+		char *end;
+		addr = strtoul(p, &end, 16);
+		if (end - p >= 4 && isspace((unsigned char)*end) && sscanf(end, "%127s", b) == 1)
+			sym_add(b, addr);
+	}
+
+	fclose(f);
+}
+
+static int loc_parse(const char *s, uint16_t *addr)
+{
+	char name[128];
+	char *end;
+	unsigned long val;
+
+	if (s[0] == '$') {
+		val = strtoul(s + 1, &end, 16);
+		if (*end != '\0' || val > 0xffff)
+			return -1;
+		*addr = val;
+		return 0;
+	}
+
+	if (isdigit((unsigned char)s[0])) {
+		val = strtoul(s, &end, 0);
+		if (*end != '\0' || val > 0xffff)
+			return -1;
+		*addr = val;
+		return 0;
+	}
+
+	const char *plus = strchr(s, '+');
+	size_t len = plus ? (size_t)(plus - s) : strlen(s);
+	unsigned long off = 0;
+
+	if (len >= sizeof(name))
+		return -1;
+	memcpy(name, s, len);
+	name[len] = '\0';
+
+	if (plus != NULL) {
+		off = strtoul(plus + 1, &end, 0);
+		if (*end != '\0')
+			return -1;
+	}
+
+	for (size_t i = 0; i < nsyms; ++i) {
+		if (strcmp(syms[i].name, name) == 0) {
+			*addr = syms[i].addr + off;
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+static void annot_load(const char *path)
+{
+	static const char *kinds[] = { "loop", "repeat", "jump", "extern" };
+	FILE *f = fopen(path, "r");
+	char line[512];
+	int lineno = 0;
+
+	if (f == NULL) { perror(path); exit(1); }
+
+	while (fgets(line, sizeof(line), f) != NULL) {
+		char *tok[16];
+		int ntok = 0;
+
+		++lineno;
+		char *hash = strchr(line, '#');
+		if (hash != NULL)
+			*hash = '\0';
+
+		for (char *t = strtok(line, " \t\r\n"); t != NULL && ntok < 16; t = strtok(NULL, " \t\r\n"))
+			tok[ntok++] = t;
+
+		if (ntok == 0)
+			continue;
+
+		int kind = -1;
+		for (int i = 0; i < 4; ++i) {
+			if (strcmp(tok[0], kinds[i]) == 0)
+				kind = i;
+		}
+
+		uint16_t addr;
+		if (kind < 0 || ntok < 3 || loc_parse(tok[1], &addr) < 0) {
+			fprintf(stderr, "%s:%d: malformed annotation\n", path, lineno);
+			exit(1);
+		}
+
+		for (int i = 2; i < ntok; ++i) {
+			uint16_t target;
+			long long val;
+
+			if (kind == ANNOT_JUMP) {
+				if (loc_parse(tok[i], &target) < 0) {
+					fprintf(stderr, "%s:%d: unknown jump target %s\n", path, lineno, tok[i]);
+					exit(1);
+				}
+				val = target;
+			}
+			else {
+				val = strtoll(tok[i], NULL, 0);
+				if (val <= 0 || i > 2) {
+					fprintf(stderr, "%s:%d: malformed annotation\n", path, lineno);
+					exit(1);
+				}
+			}
+
+			annots = xrealloc(annots, (nannots + 1) * sizeof(*annots));
+			annots[nannots].kind = kind;
+			annots[nannots].addr = addr;
+			annots[nannots++].val = val;
+		}
+	}
+
+	fclose(f);
+}
+
+static const struct annot *annot_find(int kind, uint16_t addr, size_t *from)
+{
+	for (size_t i = from ? *from : 0; i < nannots; ++i) {
+		if (annots[i].kind == kind && annots[i].addr == addr) {
+			if (from)
+				*from = i + 1;
+			return &annots[i];
+		}
+	}
+	return NULL;
+}
+
+static void report_add(struct report **list, size_t *n, uint16_t addr, uint16_t func, long long val, long long iter)
+{
+	*list = xrealloc(*list, (*n + 1) * sizeof(**list));
+	(*list)[*n].addr = addr;
+	(*list)[*n].func = func;
+	(*list)[*n].val = val;
+	(*list)[(*n)++].iter = iter;
+}
+
+static int node_get(struct graph *g, uint16_t addr, int **work, size_t *nwork)
+{
+	if (g->map[addr] >= 0)
+		return g->map[addr];
+
+	if (g->nnodes == g->cnodes) {
+		g->cnodes = g->cnodes ? 2 * g->cnodes : 256;
+		g->addr = xrealloc(g->addr, g->cnodes * sizeof(*g->addr));
+	}
+
+	g->addr[g->nnodes] = addr;
+	g->map[addr] = g->nnodes;
+
+	*work = xrealloc(*work, (*nwork + 1) * sizeof(**work));
+	(*work)[(*nwork)++] = g->nnodes;
+
+	return g->nnodes++;
+}
+
+static void edge_add(struct graph *g, int from, int to, long long cost)
+{
+	if (g->nedges == g->cedges) {
+		g->cedges = g->cedges ? 2 * g->cedges : 256;
+		g->edges = xrealloc(g->edges, g->cedges * sizeof(*g->edges));
+	}
+
+	g->edges[g->nedges].from = from;
+	g->edges[g->nedges].to = to;
+	g->edges[g->nedges++].cost = cost;
+}
+
+static long long analyze(uint16_t entry);
+
+static void graph_build(struct graph *g, uint16_t entry)
+{
+	int *work = NULL;
+	size_t nwork = 0;
+
+	g->map = xrealloc(NULL, 0x10000 * sizeof(*g->map));
+	memset(g->map, 0xff, 0x10000 * sizeof(*g->map));
+
+	node_get(g, entry, &work, &nwork);
+
+	while (nwork > 0) {
+		int n = work[--nwork];
+		uint16_t pc = g->addr[n];
+		struct insn in;
+
+		if (!loaded[pc] || z180_decode(image + pc, pc, &in) < 0) {
+			fprintf(stderr, "Invalid instruction at 0x%04x %s\n", pc, sym_name(pc));
+			exit(1);
+		}
+
+		for (int i = 1; i < in.len; ++i) {
+			if (!loaded[(uint16_t)(pc + i)]) {
+				fprintf(stderr, "Instruction at 0x%04x %s outside image\n", pc, sym_name(pc));
+				exit(1);
+			}
+		}
+
+		long long w = in.mem * mwait + in.io * iwait;
+		long long c = in.t + w, cnt = in.t_nt + w;
+		uint16_t next = pc + in.len;
+		const struct annot *a;
+		size_t it = 0;
+
+		switch (in.flow) {
+			case FLOW_NEXT:
+				edge_add(g, n, node_get(g, next, &work, &nwork), c);
+				break;
+
+			case FLOW_JUMP:
+				if ((a = annot_find(ANNOT_EXTERN, in.target, NULL)) != NULL)
+					edge_add(g, n, EXIT_NODE, c + a->val);
+				else
+					edge_add(g, n, node_get(g, in.target, &work, &nwork), c);
+				break;
+
+			case FLOW_BRANCH:
+				edge_add(g, n, node_get(g, in.target, &work, &nwork), c);
+				edge_add(g, n, node_get(g, next, &work, &nwork), cnt);
+				break;
+
+			case FLOW_CALL:
+				edge_add(g, n, node_get(g, next, &work, &nwork), c + analyze(in.target));
+				break;
+
+			case FLOW_CALLCC:
+				edge_add(g, n, node_get(g, next, &work, &nwork), c + analyze(in.target));
+				edge_add(g, n, node_get(g, next, &work, &nwork), cnt);
+				break;
+
+			case FLOW_RET:
+				edge_add(g, n, EXIT_NODE, c);
+				break;
+
+			case FLOW_RETCC:
+				edge_add(g, n, EXIT_NODE, c);
+				edge_add(g, n, node_get(g, next, &work, &nwork), cnt);
+				break;
+
+			case FLOW_INDIRECT:
+				if (annot_find(ANNOT_JUMP, pc, NULL) == NULL) {
+					fprintf(stderr, "Indirect jump at 0x%04x %s needs a jump annotation\n", pc, sym_name(pc));
+					exit(1);
+				}
+				while ((a = annot_find(ANNOT_JUMP, pc, &it)) != NULL)
+					edge_add(g, n, node_get(g, a->val, &work, &nwork), c);
+				break;
+
+			case FLOW_REPEAT:
+				if ((a = annot_find(ANNOT_REPEAT, pc, NULL)) == NULL) {
+					fprintf(stderr, "Block instruction at 0x%04x %s needs a repeat annotation\n", pc, sym_name(pc));
+					exit(1);
+				}
+				edge_add(g, n, node_get(g, next, &work, &nwork), (a->val - 1) * c + cnt);
+				report_add(&loops, &nloops, pc, entry, a->val, c);
+				break;
+
+			case FLOW_HALT:
+				fprintf(stderr, "Warning: HALT/SLP at 0x%04x %s ends the path\n", pc, sym_name(pc));
+				edge_add(g, n, EXIT_NODE, c);
+				break;
+		}
+	}
+
+	free(work);
+}
+
+static void csr_build(struct graph *g, int out, int **start, int **idx)
+{
+	size_t n = g->nnodes;
+
+	*start = xrealloc(NULL, (n + 1) * sizeof(**start));
+	*idx = xrealloc(NULL, (g->nedges ? g->nedges : 1) * sizeof(**idx));
+	memset(*start, 0, (n + 1) * sizeof(**start));
+
+	for (size_t e = 0; e < g->nedges; ++e) {
+		int v = out ? g->edges[e].from : g->edges[e].to;
+		if (v >= 0)
+			++(*start)[v + 1];
+	}
+
+	for (size_t i = 0; i < n; ++i)
+		(*start)[i + 1] += (*start)[i];
+
+	int *fill = xrealloc(NULL, n * sizeof(*fill));
+	memcpy(fill, *start, n * sizeof(*fill));
+
+	for (size_t e = 0; e < g->nedges; ++e) {
+		int v = out ? g->edges[e].from : g->edges[e].to;
+		if (v >= 0)
+			(*idx)[fill[v]++] = e;
+	}
+
+	free(fill);
+}
+
+/* Reverse postorder from node 0 (entry), iterative DFS */
+static int *rpo_build(struct graph *g, int *order)
+{
+	size_t n = g->nnodes, cnt = 0;
+	int *pos = xrealloc(NULL, n * sizeof(*pos));
+	int *stack = xrealloc(NULL, n * sizeof(*stack));
+	int *it = xrealloc(NULL, n * sizeof(*it));
+	size_t sp = 0;
+
+	memset(pos, 0xff, n * sizeof(*pos));
+	memset(it, 0, n * sizeof(*it));
+
+	stack[sp++] = 0;
+	pos[0] = -2;
+
+	while (sp > 0) {
+		int v = stack[sp - 1];
+		int k = g->out_start[v] + it[v];
+
+		if (k < g->out_start[v + 1]) {
+			int to = g->edges[g->out_idx[k]].to;
+			++it[v];
+			if (to >= 0 && pos[to] == -1) {
+				pos[to] = -2;
+				stack[sp++] = to;
+			}
+			continue;
+		}
+
+		order[cnt++] = v;
+		--sp;
+	}
+
+	for (size_t i = 0; i < cnt / 2; ++i) {
+		int tmp = order[i];
+		order[i] = order[cnt - 1 - i];
+		order[cnt - 1 - i] = tmp;
+	}
+
+	for (size_t i = 0; i < cnt; ++i)
+		pos[order[i]] = i;
+
+	free(stack);
+	free(it);
+
+	return pos;
+}
+
+static int *idom_build(struct graph *g, const int *order, const int *pos)
+{
+	size_t n = g->nnodes;
+	int *idom = xrealloc(NULL, n * sizeof(*idom));
+	int changed = 1;
+
+	memset(idom, 0xff, n * sizeof(*idom));
+	idom[0] = 0;
+
+	while (changed) {
+		changed = 0;
+		for (size_t i = 1; i < n; ++i) {
+			int v = order[i], nd = -1;
+
+			for (int k = g->in_start[v]; k < g->in_start[v + 1]; ++k) {
+				int p = g->edges[g->in_idx[k]].from;
+				if (idom[p] < 0)
+					continue;
+				if (nd < 0) {
+					nd = p;
+					continue;
+				}
+
+				int a = p, b = nd;
+				while (a != b) {
+					while (pos[a] > pos[b])
+						a = idom[a];
+					while (pos[b] > pos[a])
+						b = idom[b];
+				}
+				nd = a;
+			}
+
+			if (nd >= 0 && idom[v] != nd) {
+				idom[v] = nd;
+				changed = 1;
+			}
+		}
+	}
+
+	return idom;
+}
+
+static int dominates(const int *idom, int h, int v)
+{
+	while (1) {
+		if (v == h)
+			return 1;
+		if (v == 0)
+			return 0;
+		v = idom[v];
+	}
+}
+
+static int loop_cmp(const void *a, const void *b)
+{
+	const struct loop *la = a, *lb = b;
+	return (la->size > lb->size) - (la->size < lb->size);
+}
+
+static void loops_build(struct graph *g)
+{
+	size_t n = g->nnodes;
+	int *order = xrealloc(NULL, n * sizeof(*order));
+	int *pos = rpo_build(g, order);
+	int *idom = idom_build(g, order, pos);
+	int *stack = xrealloc(NULL, n * sizeof(*stack));
+
+	for (size_t e = 0; e < g->nedges; ++e) {
+		int u = g->edges[e].from, h = g->edges[e].to;
+
+		if (h < 0 || !dominates(idom, h, u))
+			continue;
+
+		struct loop *l = NULL;
+		for (size_t i = 0; i < g->nloops; ++i) {
+			if (g->loops[i].header == h)
+				l = &g->loops[i];
+		}
+
+		if (l == NULL) {
+			g->loops = xrealloc(g->loops, (g->nloops + 1) * sizeof(*g->loops));
+			l = &g->loops[g->nloops++];
+			memset(l, 0, sizeof(*l));
+			l->header = h;
+			l->body = xrealloc(NULL, n);
+			memset(l->body, 0, n);
+			l->body[h] = 1;
+			l->size = 1;
+		}
+
+		size_t sp = 0;
+		if (!l->body[u]) {
+			l->body[u] = 1;
+			++l->size;
+			stack[sp++] = u;
+		}
+
+		while (sp > 0) {
+			int v = stack[--sp];
+			for (int k = g->in_start[v]; k < g->in_start[v + 1]; ++k) {
+				int p = g->edges[g->in_idx[k]].from;
+				if (!l->body[p]) {
+					l->body[p] = 1;
+					++l->size;
+					stack[sp++] = p;
+				}
+			}
+		}
+	}
+
+	if (g->nloops > 0)
+		qsort(g->loops, g->nloops, sizeof(*g->loops), loop_cmp);
+
+	g->inner = xrealloc(NULL, n * sizeof(*g->inner));
+	memset(g->inner, 0xff, n * sizeof(*g->inner));
+
+	for (size_t i = 0; i < g->nloops; ++i) {
+		struct loop *l = &g->loops[i];
+
+		l->parent = -1;
+		for (size_t j = i + 1; j < g->nloops && l->parent < 0; ++j) {
+			if (g->loops[j].body[l->header])
+				l->parent = j;
+		}
+
+		for (size_t v = 0; v < n; ++v) {
+			if (l->body[v] && g->inner[v] < 0)
+				g->inner[v] = i;
+		}
+
+		for (size_t e = 0; e < g->nedges; ++e) {
+			int to = g->edges[e].to;
+			if (l->body[g->edges[e].from] && (to < 0 || !l->body[to])) {
+				l->exits = xrealloc(l->exits, (l->nexits + 1) * sizeof(*l->exits));
+				l->exits[l->nexits++] = e;
+			}
+		}
+	}
+
+	free(order);
+	free(pos);
+	free(idom);
+	free(stack);
+}
+
+static int rep(const struct graph *g, int v, int region)
+{
+	int l = g->inner[v];
+
+	if (l < 0 || l == region)
+		return v;
+
+	while (g->loops[l].parent != region)
+		l = g->loops[l].parent;
+
+	return g->nnodes + l;
+}
+
+static void rep_edges(const struct graph *g, int r, const int **list, size_t *cnt)
+{
+	if ((size_t)r < g->nnodes) {
+		*list = g->out_idx + g->out_start[r];
+		*cnt = g->out_start[r + 1] - g->out_start[r];
+	}
+	else {
+		*list = g->loops[r - g->nnodes].exits;
+		*cnt = g->loops[r - g->nnodes].nexits;
+	}
+}
+
+/* Longest paths through a region (loop body or whole function) with inner
+ * loops collapsed. Returns longest path to an exit, iter gets the longest
+ * path back to the loop header. */
+static long long region_eval(struct graph *g, int region, long long *iter)
+{
+	size_t total = g->nnodes + g->nloops;
+	int header = (region >= 0) ? g->loops[region].header : 0;
+	const uint8_t *body = (region >= 0) ? g->loops[region].body : NULL;
+	int start = rep(g, header, region);
+
+	long long *dist = xrealloc(NULL, total * sizeof(*dist));
+	uint8_t *color = xrealloc(NULL, total);
+	int *order = xrealloc(NULL, total * sizeof(*order));
+	int *stack = xrealloc(NULL, total * sizeof(*stack));
+	size_t *it = xrealloc(NULL, total * sizeof(*it));
+	size_t cnt = 0, sp = 0;
+	long long exit_max = -1, iter_max = -1;
+
+	memset(color, 0, total);
+
+	stack[sp++] = start;
+	it[start] = 0;
+	color[start] = 1;
+
+	while (sp > 0) {
+		int r = stack[sp - 1];
+		const int *list;
+		size_t n;
+
+		rep_edges(g, r, &list, &n);
+
+		if (it[r] < n) {
+			int to = g->edges[list[it[r]++]].to;
+
+			if (to < 0 || (body != NULL && (to == header || !body[to])))
+				continue;
+
+			int t = rep(g, to, region);
+			if (color[t] == 1) {
+				fprintf(stderr, "Irreducible loop at 0x%04x %s\n", g->addr[to], sym_name(g->addr[to]));
+				exit(1);
+			}
+			if (color[t] == 0) {
+				color[t] = 1;
+				it[t] = 0;
+				stack[sp++] = t;
+			}
+			continue;
+		}
+
+		color[r] = 2;
+		order[cnt++] = r;
+		--sp;
+	}
+
+	for (size_t i = 0; i < total; ++i)
+		dist[i] = -1;
+	dist[start] = 0;
+
+	while (cnt > 0) {
+		int r = order[--cnt];
+		const int *list;
+		size_t n;
+
+		if (dist[r] < 0)
+			continue;
+
+		int super = (size_t)r >= g->nnodes;
+		long long out = dist[r] + (super ? g->loops[r - g->nnodes].cost : 0);
+
+		rep_edges(g, r, &list, &n);
+		for (size_t k = 0; k < n; ++k) {
+			const struct edge *e = &g->edges[list[k]];
+			long long d = out + (super ? 0 : e->cost);
+
+			if (e->to < 0 || (body != NULL && !body[e->to])) {
+				if (d > exit_max)
+					exit_max = d;
+			}
+			else if (body != NULL && e->to == header) {
+				if (d > iter_max)
+					iter_max = d;
+			}
+			else {
+				int t = rep(g, e->to, region);
+				if (d > dist[t])
+					dist[t] = d;
+			}
+		}
+	}
+
+	free(dist);
+	free(color);
+	free(order);
+	free(stack);
+	free(it);
+
+	if (iter != NULL)
+		*iter = iter_max;
+
+	return exit_max;
+}
+
+static void graph_free(struct graph *g)
+{
+	for (size_t i = 0; i < g->nloops; ++i) {
+		free(g->loops[i].body);
+		free(g->loops[i].exits);
+	}
+	free(g->loops);
+	free(g->inner);
+	free(g->map);
+	free(g->addr);
+	free(g->edges);
+	free(g->out_start);
+	free(g->out_idx);
+	free(g->in_start);
+	free(g->in_idx);
+}
+
+static long long analyze(uint16_t entry)
+{
+	const struct annot *a = annot_find(ANNOT_EXTERN, entry, NULL);
+	struct graph g;
+
+	if (a != NULL)
+		return a->val;
+
+	if (fstate[entry] == 2)
+		return fwcet[entry];
+
+	if (fstate[entry] == 1) {
+		fprintf(stderr, "Recursion through 0x%04x %s\n", entry, sym_name(entry));
+		exit(1);
+	}
+
+	fstate[entry] = 1;
+
+	memset(&g, 0, sizeof(g));
+	graph_build(&g, entry);
+	csr_build(&g, 1, &g.out_start, &g.out_idx);
+	csr_build(&g, 0, &g.in_start, &g.in_idx);
+	loops_build(&g);
+
+	for (size_t i = 0; i < g.nloops; ++i) {
+		struct loop *l = &g.loops[i];
+		uint16_t haddr = g.addr[l->header];
+		long long iter, ex;
+
+		if ((a = annot_find(ANNOT_LOOP, haddr, NULL)) == NULL) {
+			fprintf(stderr, "Loop at 0x%04x %s needs a loop annotation\n", haddr, sym_name(haddr));
+			exit(1);
+		}
+
+		ex = region_eval(&g, i, &iter);
+		if (ex < 0) {
+			fprintf(stderr, "Loop at 0x%04x %s never exits\n", haddr, sym_name(haddr));
+			exit(1);
+		}
+
+		l->cost = (a->val - 1) * (iter > 0 ? iter : 0) + ex;
+		report_add(&loops, &nloops, haddr, entry, a->val, iter);
+	}
+
+	long long wcet = region_eval(&g, -1, NULL);
+	if (wcet < 0) {
+		fprintf(stderr, "Function at 0x%04x %s never returns\n", entry, sym_name(entry));
+		exit(1);
+	}
+
+	graph_free(&g);
+
+	fstate[entry] = 2;
+	fwcet[entry] = wcet;
+	report_add(&funcs, &nfuncs, entry, entry, wcet, 0);
+
+	return wcet;
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "Usage: %s [-o origin] [-s map] [-a annotations] [-m waits] [-i waits] [-c hz] -e entry image.bin\n", name);
+	fprintf(stderr, "\t-o\tload address of the image, default 0\n");
+	fprintf(stderr, "\t-s\tz88dk or SDCC map/noi file\n");
+	fprintf(stderr, "\t-a\tloop bounds and other annotations\n");
+	fprintf(stderr, "\t-m\tmemory wait states per access (DCNTL MWI)\n");
+	fprintf(stderr, "\t-i\tadditional I/O wait states per access (DCNTL IWI)\n");
+	fprintf(stderr, "\t-c\tCPU clock, default 6144000\n");
+	fprintf(stderr, "\t-e\tentry point, symbol[+offset] or address\n");
+}
+
+int main(int argc, char *argv[])
+{
+	const char *map = NULL, *annot = NULL, *entry_str = NULL;
+	unsigned long origin = 0, cpu = 6144000;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "o:s:a:m:i:c:e:")) != -1) {
+		switch (opt) {
+			case 'o':
+				origin = strtoul(optarg, NULL, 0);
+				break;
+
+			case 's':
+				map = optarg;
+				break;
+
+			case 'a':
+				annot = optarg;
+				break;
+
+			case 'm':
+				mwait = strtoul(optarg, NULL, 0);
+				break;
+
+			case 'i':
+				iwait = strtoul(optarg, NULL, 0);
+				break;
+
+			case 'c':
+				cpu = strtoul(optarg, NULL, 0);
+				break;
+
+			case 'e':
+				entry_str = optarg;
+				break;
+
+			default:
+				usage(argv[0]);
+				return 1;
+		}
+	}
+
+	if (argc - optind != 1 || entry_str == NULL || origin > 0xffff || cpu == 0) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	FILE *f = fopen(argv[optind], "rb");
+	if (f == NULL) { perror(argv[optind]); return 1; }
+	size_t size = fread(image + origin, 1, 0x10000 - origin, f);
+	fclose(f);
+	memset(loaded + origin, 1, size);
+
+	if (map != NULL)
+		map_load(map);
+	if (annot != NULL)
+		annot_load(annot);
+
+	uint16_t entry;
+	if (loc_parse(entry_str, &entry) < 0) {
+		fprintf(stderr, "Unknown entry point %s\n", entry_str);
+		return 1;
+	}
+
+	long long wcet = analyze(entry);
+	unsigned long budget = VBLANK_PCLK * cpu / PCLK;
+
+	printf("entry:   0x%04x %s\n", entry, sym_name(entry));
+	printf("wcet:    %lld T-states (memory waits %u, I/O waits %u)\n", wcet, mwait, iwait);
+	printf("budget:  %lu T-states per VBLANK @ %lu Hz, %.1f%% used\n", budget, cpu, 100. * wcet / budget);
+
+	printf("\nfunctions:\n");
+	for (size_t i = 0; i < nfuncs; ++i)
+		printf("  0x%04x %-32s %8lld\n", funcs[i].addr, sym_name(funcs[i].addr), funcs[i].val);
+
+	if (nloops > 0) {
+		printf("\nloops:\n");
+		for (size_t i = 0; i < nloops; ++i)
+			printf("  0x%04x %-32s x%-6lld %6lld per iteration\n", loops[i].addr, sym_name(loops[i].addr), loops[i].val, loops[i].iter);
+	}
+
+	if ((unsigned long long)wcet > budget) {
+		printf("\nEXCEEDED: handler does not fit in VBLANK\n");
+		return 2;
+	}
+
+	return 0;
+}
@@ -0,0 +1,298 @@
+#include <string.h>
+
+#include "z180.h"
+
+/* Timings from the Z180 instruction summary, without programmable waits */
+
+static int op(struct insn *in, uint8_t len, uint8_t t, uint8_t data, uint8_t io)
+{
+	in->len = len;
+	in->flow = FLOW_NEXT;
+	in->t = t;
+	in->t_nt = t;
+	in->mem = len + data;
+	in->io = io;
+	in->target = 0;
+
+	return 0;
+}
+
+static int flow(struct insn *in, uint8_t flow, uint16_t target, uint8_t t_nt)
+{
+	in->flow = flow;
+	in->target = target;
+	in->t_nt = t_nt;
+
+	return 0;
+}
+
+static uint16_t imm16(const uint8_t *code)
+{
+	return code[0] | code[1] << 8;
+}
+
+static int decode_cb(const uint8_t *code, struct insn *in)
+{
+	uint8_t x = code[1] >> 6, y = (code[1] >> 3) & 7, z = code[1] & 7;
+
+	if (x == 0 && y == 6)
+		return -1;
+
+	if (x == 1)
+		return (z == 6) ? op(in, 2, 9, 1, 0) : op(in, 2, 6, 0, 0);
+
+	return (z == 6) ? op(in, 2, 13, 2, 0) : op(in, 2, 7, 0, 0);
+}
+
+static int decode_index(const uint8_t *code, struct insn *in)
+{
+	uint8_t opc = code[1];
+	uint8_t x = opc >> 6, y = (opc >> 3) & 7, z = opc & 7;
+
+	switch (opc) {
+		case 0x09: case 0x19: case 0x29: case 0x39:
+			return op(in, 2, 10, 0, 0);
+		case 0x21:
+			return op(in, 4, 12, 0, 0);
+		case 0x22:
+			return op(in, 4, 19, 2, 0);
+		case 0x2a:
+			return op(in, 4, 18, 2, 0);
+		case 0x23: case 0x2b:
+			return op(in, 2, 7, 0, 0);
+		case 0x34: case 0x35:
+			return op(in, 3, 18, 2, 0);
+		case 0x36:
+			return op(in, 4, 15, 1, 0);
+		case 0xe1:
+			return op(in, 2, 12, 2, 0);
+		case 0xe5:
+			return op(in, 2, 14, 2, 0);
+		case 0xe3:
+			return op(in, 2, 19, 4, 0);
+		case 0xe9:
+			op(in, 2, 6, 0, 0);
+			return flow(in, FLOW_INDIRECT, 0, 6);
+		case 0xf9:
+			return op(in, 2, 7, 0, 0);
+		case 0xcb: {
+			uint8_t sub = code[3];
+			uint8_t sx = sub >> 6, sy = (sub >> 3) & 7;
+
+			if ((sub & 7) != 6 || (sx == 0 && sy == 6))
+				return -1;
+			if (sx == 1)
+				return op(in, 4, 15, 1, 0);
+			return op(in, 4, 19, 2, 0);
+		}
+	}
+
+	if (x == 1 && z == 6 && y != 6)
+		return op(in, 3, 14, 1, 0);
+	if (x == 1 && y == 6 && z != 6)
+		return op(in, 3, 15, 1, 0);
+	if (x == 2 && z == 6)
+		return op(in, 3, 14, 1, 0);
+
+	return -1;
+}
+
+static int decode_ed(const uint8_t *code, struct insn *in)
+{
+	uint8_t opc = code[1];
+	uint8_t x = opc >> 6, y = (opc >> 3) & 7, z = opc & 7;
+
+	if (x == 0) {
+		switch (z) {
+			case 0:
+				return op(in, 3, 12, 0, 1);
+			case 1:
+				return (y == 6) ? -1 : op(in, 3, 13, 0, 1);
+			case 4:
+				return (y == 6) ? op(in, 2, 10, 1, 0) : op(in, 2, 7, 0, 0);
+		}
+		return -1;
+	}
+
+	if (x == 1) {
+		switch (z) {
+			case 0:
+				return op(in, 2, 9, 0, 1);
+			case 1:
+				return (y == 6) ? -1 : op(in, 2, 10, 0, 1);
+			case 2:
+				return op(in, 2, 10, 0, 0);
+			case 3:
+				return (y & 1) ? op(in, 4, 18, 2, 0) : op(in, 4, 19, 2, 0);
+			case 4:
+				if (y == 0)
+					return op(in, 2, 6, 0, 0);
+				if (y & 1)
+					return op(in, 2, 17, 0, 0);
+				if (y == 4)
+					return op(in, 3, 9, 0, 0);
+				if (y == 6)
+					return op(in, 3, 12, 0, 1);
+				return -1;
+			case 5:
+				if (y > 1)
+					return -1;
+				op(in, 2, 12, 2, 0);
+				return flow(in, FLOW_RET, 0, 12);
+			case 6:
+				if (y == 6) {
+					op(in, 2, 8, 0, 0);
+					return flow(in, FLOW_HALT, 0, 8);
+				}
+				return (y == 0 || y == 2 || y == 3) ? op(in, 2, 6, 0, 0) : -1;
+			case 7:
+				if (y < 4)
+					return op(in, 2, 6, 0, 0);
+				if (y < 6)
+					return op(in, 2, 16, 2, 0);
+				return -1;
+		}
+	}
+
+	if (x == 2) {
+		/* OTIM, OTDM, OTIMR, OTDMR */
+		if (z == 3 && (y == 0 || y == 1))
+			return op(in, 2, 14, 1, 1);
+		if (z == 3 && (y == 2 || y == 3)) {
+			op(in, 2, 16, 1, 1);
+			return flow(in, FLOW_REPEAT, 0, 14);
+		}
+
+		if (y < 4 || z > 3)
+			return -1;
+
+		uint8_t data = (z == 0) ? 2 : 1, io = (z >= 2) ? 1 : 0;
+		if (y < 6)
+			return op(in, 2, 12, data, io);
+
+		op(in, 2, 14, data, io);
+		return flow(in, FLOW_REPEAT, 0, 12);
+	}
+
+	return -1;
+}
+
+int z180_decode(const uint8_t *code, uint16_t pc, struct insn *in)
+{
+	uint8_t opc = code[0];
+	uint8_t x = opc >> 6, y = (opc >> 3) & 7, z = opc & 7;
+	uint8_t p = y >> 1, q = y & 1;
+	uint16_t rel = pc + 2 + (int8_t)code[1];
+
+	memset(in, 0, sizeof(*in));
+
+	if (x == 0) {
+		switch (z) {
+			case 0:
+				if (y == 0)
+					return op(in, 1, 3, 0, 0);
+				if (y == 1)
+					return op(in, 1, 4, 0, 0);
+				if (y == 2) {
+					op(in, 2, 9, 0, 0);
+					return flow(in, FLOW_BRANCH, rel, 7);
+				}
+				if (y == 3) {
+					op(in, 2, 8, 0, 0);
+					return flow(in, FLOW_JUMP, rel, 8);
+				}
+				op(in, 2, 8, 0, 0);
+				return flow(in, FLOW_BRANCH, rel, 6);
+			case 1:
+				return q ? op(in, 1, 7, 0, 0) : op(in, 3, 9, 0, 0);
+			case 2: {
+				static const uint8_t len[4] = { 1, 1, 3, 3 };
+				static const uint8_t data[4] = { 1, 1, 2, 1 };
+				static const uint8_t st[4] = { 7, 7, 16, 13 };
+				static const uint8_t ld[4] = { 6, 6, 15, 12 };
+				return op(in, len[p], q ? ld[p] : st[p], data[p], 0);
+			}
+			case 3:
+				return op(in, 1, 4, 0, 0);
+			case 4:
+			case 5:
+				return (y == 6) ? op(in, 1, 10, 2, 0) : op(in, 1, 4, 0, 0);
+			case 6:
+				return (y == 6) ? op(in, 2, 9, 1, 0) : op(in, 2, 6, 0, 0);
+			case 7:
+				return op(in, 1, (y == 4) ? 4 : 3, 0, 0);
+		}
+	}
+
+	if (x == 1) {
+		if (y == 6 && z == 6) {
+			op(in, 1, 3, 0, 0);
+			return flow(in, FLOW_HALT, 0, 3);
+		}
+		if (z == 6)
+			return op(in, 1, 6, 1, 0);
+		if (y == 6)
+			return op(in, 1, 7, 1, 0);
+		return op(in, 1, 4, 0, 0);
+	}
+
+	if (x == 2)
+		return (z == 6) ? op(in, 1, 6, 1, 0) : op(in, 1, 4, 0, 0);
+
+	switch (z) {
+		case 0:
+			op(in, 1, 10, 2, 0);
+			return flow(in, FLOW_RETCC, 0, 5);
+		case 1:
+			if (q == 0)
+				return op(in, 1, 9, 2, 0);
+			if (p == 0) {
+				op(in, 1, 9, 2, 0);
+				return flow(in, FLOW_RET, 0, 9);
+			}
+			if (p == 1)
+				return op(in, 1, 3, 0, 0);
+			if (p == 2) {
+				op(in, 1, 3, 0, 0);
+				return flow(in, FLOW_INDIRECT, 0, 3);
+			}
+			return op(in, 1, 4, 0, 0);
+		case 2:
+			op(in, 3, 9, 0, 0);
+			return flow(in, FLOW_BRANCH, imm16(code + 1), 6);
+		case 3:
+			switch (y) {
+				case 0:
+					op(in, 3, 9, 0, 0);
+					return flow(in, FLOW_JUMP, imm16(code + 1), 9);
+				case 1:
+					return decode_cb(code, in);
+				case 2:
+					return op(in, 2, 10, 0, 1);
+				case 3:
+					return op(in, 2, 9, 0, 1);
+				case 4:
+					return op(in, 1, 16, 4, 0);
+				default:
+					return op(in, 1, 3, 0, 0);
+			}
+		case 4:
+			op(in, 3, 16, 2, 0);
+			return flow(in, FLOW_CALLCC, imm16(code + 1), 6);
+		case 5:
+			if (q == 0)
+				return op(in, 1, 11, 2, 0);
+			if (p == 0) {
+				op(in, 3, 16, 2, 0);
+				return flow(in, FLOW_CALL, imm16(code + 1), 16);
+			}
+			if (p == 2)
+				return decode_ed(code, in);
+			return decode_index(code, in);
+		case 6:
+			return op(in, 2, 6, 0, 0);
+		default:
+			op(in, 1, 11, 2, 0);
+			return flow(in, FLOW_CALL, y * 8, 11);
+	}
+}
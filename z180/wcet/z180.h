@@ -0,0 +1,35 @@
+#ifndef Z180_H_
+#define Z180_H_
+
+#include <stdint.h>
+
+enum {
+	FLOW_NEXT,
+	FLOW_JUMP,
+	FLOW_BRANCH,
+	FLOW_CALL,
+	FLOW_CALLCC,
+	FLOW_RET,
+	FLOW_RETCC,
+	FLOW_INDIRECT,
+	FLOW_REPEAT,
+	FLOW_HALT
+};
+
+struct insn {
+	uint8_t len;
+	uint8_t flow;
+	/* T-states when taken (or repeating), and when not taken (or last) */
+	uint8_t t;
+	uint8_t t_nt;
+	/* Memory accesses including opcode fetch, I/O accesses */
+	uint8_t mem;
+	uint8_t io;
+	uint16_t target;
+};
+
+/* Decodes instruction at pc, code must hold at least 4 bytes.
+ * Returns -1 on opcodes that trap on Z180. */
+int z180_decode(const uint8_t *code, uint16_t pc, struct insn *in);
+
+#endif